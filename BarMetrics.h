@@ -0,0 +1,273 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-17 00:41:09
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-17 00:41:09
+ */
+
+#ifndef BAR_METRICS_H
+#define BAR_METRICS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+
+namespace GuG {
+
+    namespace detail {
+        // price in 1/10000 dollars, exactly
+        inline char* appendFixed4(char* out, uint64_t value) {
+            out = std::to_chars(out, out + 20, value / 10000).ptr;
+            uint64_t fraction = value % 10000;
+            *out++ = '.';
+            for (uint64_t scale = 1000; scale != 0; scale /= 10) {
+                *out++ = static_cast<char>('0' + fraction / scale % 10);
+            }
+            return out;
+        }
+    }
+
+    // Per bucket trade metrics reported next to the VWAP. Each metric is a policy with a
+    // trivially copyable State and static functions the trade path calls:
+    //   add(state, time, price, shares)    a printable trade (E, C, P, Q)
+    //   remove(state, price, shares)       a Broken Trade of this bucket
+    //   finish(state, end)                 the bucket is reported up to time end
+    //   format(out, state)                 appends ",value..." for the metric's kColumns
+    // A BarPack composes them at compile time; the metrics of a build are TradeBars below.
+
+    // Time weighted average price: each trade price holds until the next trade, and the last one
+    // until the end of the bucket. Measured from the bucket's first trade
+    struct Twap {
+        struct State {
+            uint64_t first_time = UINT64_MAX;   // no trade yet
+            uint64_t last_time = 0;
+            uint32_t last_price = 0;
+            double weighted = 0;                // sum of price * ns
+        };
+        static constexpr std::string_view kColumns = "TWAP";
+        static constexpr size_t kMaxSize = 32;
+
+        static void add(State& state, uint64_t time, uint32_t price, uint64_t) {
+            if (state.first_time == UINT64_MAX) state.first_time = time;
+            else if (time > state.last_time) state.weighted += static_cast<double>(state.last_price) * (time - state.last_time);
+            state.last_time = std::max(state.last_time, time);
+            state.last_price = price;
+        }
+        // the price path of a broken print cannot be taken back out of the weights
+        static void remove(State&, uint32_t, uint64_t) {}
+        static void finish(State& state, uint64_t end) {
+            if (state.first_time == UINT64_MAX || end <= state.last_time) return;
+            state.weighted += static_cast<double>(state.last_price) * (end - state.last_time);
+            state.last_time = end;
+        }
+        static char* format(char* out, const State& state) {
+            *out++ = ',';
+            if (state.first_time == UINT64_MAX) return out;
+            uint64_t duration = state.last_time - state.first_time;
+            double twap = duration != 0 ? state.weighted / duration : state.last_price;
+            return std::to_chars(out, out + 30, twap / 10000.0, std::chars_format::fixed, 4).ptr;
+        }
+    };
+
+    struct Ohlc {
+        struct State {
+            uint32_t open = 0;
+            uint32_t high = 0;
+            uint32_t low = UINT32_MAX;  // above high until the first trade
+            uint32_t close = 0;
+        };
+        static constexpr std::string_view kColumns = "OPEN,HIGH,LOW,CLOSE";
+        static constexpr size_t kMaxSize = 4 * 16;
+
+        static void add(State& state, uint64_t, uint32_t price, uint64_t) {
+            if (state.low > state.high) state.open = price;
+            state.high = std::max(state.high, price);
+            state.low = std::min(state.low, price);
+            state.close = price;
+        }
+        // extremes of the remaining trades are not kept, a broken print stays in the bar
+        static void remove(State&, uint32_t, uint64_t) {}
+        static void finish(State&, uint64_t) {}
+        static char* format(char* out, const State& state) {
+            if (state.low > state.high) {
+                for (int column = 0; column < 4; ++column) *out++ = ',';
+                return out;
+            }
+            for (uint32_t price : { state.open, state.high, state.low, state.close }) {
+                *out++ = ',';
+                out = detail::appendFixed4(out, price);
+            }
+            return out;
+        }
+    };
+
+    struct TradeVolume {
+        struct State {
+            uint64_t volume = 0;
+        };
+        static constexpr std::string_view kColumns = "VOLUME";
+        static constexpr size_t kMaxSize = 24;
+
+        static void add(State& state, uint64_t, uint32_t, uint64_t shares) { state.volume += shares; }
+        static void remove(State& state, uint32_t, uint64_t shares) { state.volume -= shares; }
+        static void finish(State&, uint64_t) {}
+        static char* format(char* out, const State& state) {
+            *out++ = ',';
+            return std::to_chars(out, out + 20, state.volume).ptr;
+        }
+    };
+
+    struct TradeNotional {
+        struct State {
+            uint64_t notional = 0;  // price * shares in 1/10000 dollars
+        };
+        static constexpr std::string_view kColumns = "NOTIONAL";
+        static constexpr size_t kMaxSize = 32;
+
+        static void add(State& state, uint64_t, uint32_t price, uint64_t shares) { state.notional += static_cast<uint64_t>(price) * shares; }
+        static void remove(State& state, uint32_t price, uint64_t shares) { state.notional -= static_cast<uint64_t>(price) * shares; }
+        static void finish(State&, uint64_t) {}
+        static char* format(char* out, const State& state) {
+            *out++ = ',';
+            return detail::appendFixed4(out, state.notional);
+        }
+    };
+
+    struct TradeCount {
+        struct State {
+            uint64_t trades = 0;
+        };
+        static constexpr std::string_view kColumns = "TRADES";
+        static constexpr size_t kMaxSize = 24;
+
+        static void add(State& state, uint64_t, uint32_t, uint64_t) { ++state.trades; }
+        static void remove(State& state, uint32_t, uint64_t) { --state.trades; }
+        static void finish(State&, uint64_t) {}
+        static char* format(char* out, const State& state) {
+            *out++ = ',';
+            return std::to_chars(out, out + 20, state.trades).ptr;
+        }
+    };
+
+    // The metrics of a build, composed at compile time. State holds every metric's state as a
+    // base, so an empty pack is an empty struct and each call folds over the pack: a build
+    // without bar metrics runs no bar code at all.
+    template<typename... Metrics>
+    struct BarPack {
+        struct State : Metrics::State... {};
+
+        static constexpr size_t kSize = sizeof...(Metrics);
+        static constexpr size_t kMaxSize = (size_t{ 0 } + ... + Metrics::kMaxSize);
+
+        static void add(State& state, uint64_t time, uint32_t price, uint64_t shares) {
+            (Metrics::add(static_cast<typename Metrics::State&>(state), time, price, shares), ...);
+        }
+        static void remove(State& state, uint32_t price, uint64_t shares) {
+            (Metrics::remove(static_cast<typename Metrics::State&>(state), price, shares), ...);
+        }
+        static void finish(State& state, uint64_t end) {
+            (Metrics::finish(static_cast<typename Metrics::State&>(state), end), ...);
+        }
+        static char* format(char* out, const State& state) {
+            ((out = Metrics::format(out, static_cast<const typename Metrics::State&>(state))), ...);
+            return out;
+        }
+
+        // ",TWAP,OPEN,..." for the CSV header, empty for an empty pack
+        static std::string columns() {
+            std::string text;
+            ((text += ',', text += Metrics::kColumns), ...);
+            return text;
+        }
+    };
+
+#if defined(GUG_BAR_METRICS)
+    // -DGUG_BAR_METRICS="GuG::Ohlc,GuG::TradeCount" picks the metrics and their column order
+    using TradeBars = BarPack<GUG_BAR_METRICS>;
+#elif defined(GUG_WITH_BARS)
+    using TradeBars = BarPack<Twap, Ohlc, TradeVolume, TradeNotional, TradeCount>;
+#else
+    using TradeBars = BarPack<>;
+#endif
+    constexpr bool kBarsEnabled = TradeBars::kSize != 0;
+
+    // The open bar of every stock of a shard, indexed by stock locate. A bar is reported once
+    // when its bucket closes, so only the open bucket is kept; a stock's first trade in a new
+    // bucket starts a new bar. With an empty pack every member is a no-op.
+    template<typename Pack>
+    class BarTable {
+    public:
+        void add(uint16_t stock_id, uint32_t bucket, uint64_t time, uint32_t price, uint64_t shares) {
+            if constexpr (Pack::kSize != 0) {
+                if (stock_id >= bars_.size()) bars_.resize(static_cast<size_t>(stock_id) + 1);
+                Bar& bar = bars_[stock_id];
+                if (bar.bucket != bucket) {
+                    bar.bucket = bucket;
+                    bar.state = {};
+                }
+                Pack::add(bar.state, time, price, shares);
+            }
+        }
+
+        // Breaks of trades in buckets already reported are ignored
+        void remove(uint16_t stock_id, uint32_t bucket, uint32_t price, uint64_t shares) {
+            if constexpr (Pack::kSize != 0) {
+                if (stock_id < bars_.size() && bars_[stock_id].bucket == bucket) {
+                    Pack::remove(bars_[stock_id].state, price, shares);
+                }
+            }
+        }
+
+        // A re-listed stock starts without trades
+        void clear(uint16_t stock_id) {
+            if constexpr (Pack::kSize != 0) {
+                if (stock_id < bars_.size()) bars_[stock_id] = Bar{};
+            }
+        }
+
+        // The stock's bar for bucket, finished at time end; an empty bar if it did not trade
+        typename Pack::State bar(uint16_t stock_id, uint32_t bucket, uint64_t end) const {
+            typename Pack::State state{};
+            if constexpr (Pack::kSize != 0) {
+                if (stock_id < bars_.size() && bars_[stock_id].bucket == bucket) {
+                    state = bars_[stock_id].state;
+                    Pack::finish(state, end);
+                }
+            }
+            return state;
+        }
+
+        // Checkpoint image, see Checkpoint.h; the columns identify the pack it was saved with
+        template<typename Out>
+        void save(Out& out) const {
+            std::string columns = Pack::columns();
+            out.putVector(std::vector<char>(columns.begin(), columns.end()));
+            out.putVector(bars_);
+        }
+
+        template<typename In>
+        void load(In& in) {
+            std::vector<char> columns;
+            in.getVector(columns);
+            if (std::string(columns.begin(), columns.end()) != Pack::columns()) in.fail();
+            in.getVector(bars_);
+        }
+
+    private:
+        struct Bar {
+            uint32_t bucket = UINT32_MAX;
+            typename Pack::State state{};
+        };
+
+        std::vector<Bar> bars_;
+    };
+
+    using TradeBarTable = BarTable<TradeBars>;
+}
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 23:02:47
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 23:02:47
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <glob.h>          // For glob
+#include <spawn.h>         // For posix_spawn
+#include <fcntl.h>         // For open flags
+#include <unistd.h>        // For sysconf
+#include <sys/stat.h>      // For stat, mkdir
+#include <sys/wait.h>      // For wait4
+#include <sys/resource.h>  // For rusage
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Options.h"
+#include "OrderTable.h"
+#include "OrderBook.h"
+#include "TradeJournal.h"
+#include "ShardRouter.h"
+
+extern char** environ;
+
+namespace GuG {
+
+    // One input of a batch: the child run's CSV and its log go to the batch directory
+    struct BatchJob {
+        std::string input;
+        uint64_t size = 0;
+        uint64_t memory = 0;    // estimate the scheduler reserves while the job runs
+        std::string output;
+        std::string log;
+    };
+
+    struct BatchResult {
+        int exit_code = -1;     // 128 + signal for a killed job
+        double seconds = 0;
+        uint64_t peak_rss_kb = 0;
+    };
+
+    namespace detail {
+        // Each pattern is a path or a glob(3) pattern; a pattern without a match is an error
+        inline std::vector<std::string> expandInputs(const std::vector<std::string>& patterns) {
+            std::vector<std::string> inputs;
+            for (const std::string& pattern : patterns) {
+                glob_t matches{};
+                int result = ::glob(pattern.c_str(), 0, nullptr, &matches);
+                if (result == 0) {
+                    inputs.insert(inputs.end(), matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+                }
+                ::globfree(&matches);
+                if (result != 0) {
+                    throw std::runtime_error("No input matches " + pattern);
+                }
+            }
+            std::sort(inputs.begin(), inputs.end());
+            inputs.erase(std::unique(inputs.begin(), inputs.end()), inputs.end());
+            return inputs;
+        }
+
+        // File name without its directory and its last extension (two for .itch.gz style names)
+        inline std::string inputStem(const std::string& path) {
+            std::string name = path.substr(path.find_last_of('/') + 1);
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0) name.resize(name.size() - 3);
+            size_t dot = name.find_last_of('.');
+            return dot == 0 || dot == std::string::npos ? name : name.substr(0, dot);
+        }
+
+        inline uint64_t physicalMemory() {
+            long pages = sysconf(_SC_PHYS_PAGES);
+            long page_size = sysconf(_SC_PAGESIZE);
+            return pages > 0 && page_size > 0 ? static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size) : 0;
+        }
+    }
+
+    // Peak memory of one run: the input is mapped and read once, so all of it can become
+    // resident, plus the order tables (the book's orders in a book build) at their pre-sized
+    // capacity, the trade journals at their horizon, the full shard queues and a fixed
+    // allowance for the symbol tables, writer buffers and thread stacks
+    inline uint64_t estimateJobMemory(const Options& options, uint64_t input_size) {
+        size_t capacity = 16;
+        while (capacity < options.expected_orders * 2) capacity <<= 1;
+        uint64_t queues = options.queue_kind == QueueKind::Spsc ? options.queue_capacity : 4 * kQueueBatchSize * 64;
+        uint64_t journal = TradeJournal(options.journal_horizon).horizon() + TradeJournal::kPageSize;
+        return input_size + options.threads * (capacity * (kBookEnabled ? sizeof(BookOrder) : sizeof(OrderEntry)) + queues * sizeof(ItchMessageRecord)
+            + journal * sizeof(TradeEntry)) + (64ULL << 20);
+    }
+
+    // Runs every input of a batch as its own ItchVwapProcessor process, so a job that fails or
+    // is killed takes nothing else down and its peak RSS can be reported. At most `workers`
+    // jobs run at once, and their memory estimates add up to at most memory_limit; the largest
+    // pending job that fits is started first. A job larger than the limit runs alone.
+    class BatchScheduler {
+    public:
+        BatchScheduler(std::string program, std::vector<std::string> child_args, size_t workers, uint64_t memory_limit)
+            : program_(std::move(program)), child_args_(std::move(child_args)), workers_(std::max<size_t>(workers, 1)),
+            memory_limit_(memory_limit) {}
+
+        // Runs every job and returns their results in the order of `jobs`
+        std::vector<BatchResult> run(const std::vector<BatchJob>& jobs) {
+            using clock = std::chrono::steady_clock;
+            struct Running {
+                size_t job;
+                clock::time_point start;
+            };
+            std::vector<BatchResult> results(jobs.size());
+            std::vector<size_t> pending(jobs.size());
+            for (size_t i = 0; i < jobs.size(); ++i) pending[i] = i;
+            std::stable_sort(pending.begin(), pending.end(), [&jobs](size_t a, size_t b) { return jobs[a].size > jobs[b].size; });
+            std::map<pid_t, Running> running;
+            uint64_t reserved = 0;
+            size_t started = 0;
+            size_t finished = 0;
+
+            while (!pending.empty() || !running.empty()) {
+                while (!pending.empty() && running.size() < workers_) {
+                    // an idle pool takes the largest job even if it is over the limit on its own
+                    auto fits = running.empty() ? pending.begin() : std::find_if(pending.begin(), pending.end(), [&](size_t job) {
+                        return reserved + jobs[job].memory <= memory_limit_;
+                        });
+                    if (fits == pending.end()) break;
+                    size_t job = *fits;
+                    pending.erase(fits);
+                    ++started;
+                    pid_t pid = spawn(jobs[job]);
+                    if (pid == -1) {
+                        ++finished;
+                        std::cout << "[" << finished << "/" << jobs.size() << "] " << jobs[job].input
+                            << " could not be started: " << std::strerror(errno) << std::endl;
+                        continue;
+                    }
+                    reserved += jobs[job].memory;
+                    running[pid] = { job, clock::now() };
+                    std::cout << "started " << jobs[job].input << " (" << (jobs[job].size >> 20) << " MB, "
+                        << started << " of " << jobs.size() << ")" << std::endl;
+                }
+                if (running.empty()) continue;
+
+                int status = 0;
+                rusage usage{};
+                pid_t pid = ::wait4(-1, &status, 0, &usage);
+                if (pid == -1) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error(std::string("wait4 failed: ") + std::strerror(errno));
+                }
+                auto it = running.find(pid);
+                if (it == running.end()) continue;
+                size_t job = it->second.job;
+                BatchResult& result = results[job];
+                result.seconds = std::chrono::duration<double>(clock::now() - it->second.start).count();
+                result.peak_rss_kb = static_cast<uint64_t>(usage.ru_maxrss);
+                result.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+                reserved -= jobs[job].memory;
+                running.erase(it);
+                ++finished;
+                std::cout << "[" << finished << "/" << jobs.size() << "] " << jobs[job].input;
+                if (result.exit_code == 0) {
+                    std::cout << " done in " << std::fixed << std::setprecision(1) << result.seconds << " s, "
+                        << (result.peak_rss_kb >> 10) << " MB peak RSS";
+                }
+                else {
+                    std::cout << " failed with exit code " << result.exit_code << ", see " << jobs[job].log;
+                }
+                std::cout << std::endl;
+            }
+            return results;
+        }
+
+    private:
+        // The child writes its CSV to job.output, and its stdout and stderr to job.log
+        pid_t spawn(const BatchJob& job) {
+            std::vector<std::string> args{ program_ };
+            args.insert(args.end(), child_args_.begin(), child_args_.end());
+            args.insert(args.end(), { "--output", job.output, job.input });
+            std::vector<char*> argv;
+            for (std::string& arg : args) argv.push_back(arg.data());
+            argv.push_back(nullptr);
+
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init(&actions);
+            posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, job.log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+            pid_t pid = -1;
+            int error = ::posix_spawn(&pid, program_.c_str(), &actions, nullptr, argv.data(), environ);
+            posix_spawn_file_actions_destroy(&actions);
+            if (error != 0) {
+                errno = error;
+                return -1;
+            }
+            return pid;
+        }
+
+        const std::string program_;
+        const std::vector<std::string> child_args_;
+        const size_t workers_;
+        const uint64_t memory_limit_;
+    };
+
+    // One line per input: FILE,BYTES,EXIT_CODE,SECONDS,PEAK_RSS_MB,OUTPUT
+    inline bool writeBatchSummary(const std::string& path, const std::vector<BatchJob>& jobs, const std::vector<BatchResult>& results) {
+        std::ofstream out(path, std::ios::out | std::ios::trunc);
+        out << "FILE,BYTES,EXIT_CODE,SECONDS,PEAK_RSS_MB,OUTPUT\n" << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            out << jobs[i].input << ',' << jobs[i].size << ',' << results[i].exit_code << ',' << results[i].seconds << ','
+                << (results[i].peak_rss_kb >> 10) << ',' << jobs[i].output << '\n';
+        }
+        return static_cast<bool>(out.flush());
+    }
+
+    // The batch named by options.batch_dir: every input gets <stem>.csv and <stem>.log there.
+    // Returns the process exit code, 0 if every job succeeded.
+    inline int runBatch(const Options& options, const std::string& program) {
+        std::vector<BatchJob> jobs;
+        try {
+            std::vector<std::string> patterns = options.inputs;
+            if (!options.batch_list.empty()) {
+                std::ifstream list(options.batch_list);
+                if (!list.is_open()) throw std::runtime_error("Failed to open " + options.batch_list);
+                for (std::string line; std::getline(list, line);) {
+                    line.erase(0, line.find_first_not_of(" \t\r"));
+                    line.erase(line.find_last_not_of(" \t\r") + 1);
+                    if (!line.empty() && line[0] != '#') patterns.push_back(line);
+                }
+            }
+            if (patterns.empty()) throw std::runtime_error("--batch needs input files or --batch-list");
+            if (::mkdir(options.batch_dir.c_str(), 0755) == -1 && errno != EEXIST) {
+                throw std::runtime_error("Failed to create " + options.batch_dir);
+            }
+            std::map<std::string, std::string> outputs;  // stem -> input, two inputs must not share an output
+            for (const std::string& input : detail::expandInputs(patterns)) {
+                struct stat sb;
+                if (::stat(input.c_str(), &sb) == -1 || !S_ISREG(sb.st_mode)) {
+                    throw std::runtime_error(input + " is not a regular file");
+                }
+                std::string stem = detail::inputStem(input);
+                auto [it, inserted] = outputs.emplace(stem, input);
+                if (!inserted) {
+                    throw std::runtime_error(it->second + " and " + input + " would both write " + stem + ".csv");
+                }
+                BatchJob job;
+                job.input = input;
+                job.size = static_cast<uint64_t>(sb.st_size);
+                job.memory = estimateJobMemory(options, job.size);
+                job.output = options.batch_dir + "/" + stem + ".csv";
+                job.log = options.batch_dir + "/" + stem + ".log";
+                jobs.push_back(std::move(job));
+            }
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+
+        uint64_t memory_limit = options.memory_limit != 0 ? options.memory_limit : detail::physicalMemory() * 3 / 4;
+        std::cout << jobs.size() << " files, " << options.jobs << " jobs, " << (memory_limit >> 20) << " MB memory limit" << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<BatchResult> results = BatchScheduler(program, options.child_args, options.jobs, memory_limit).run(jobs);
+        size_t failed = std::count_if(results.begin(), results.end(), [](const BatchResult& result) { return result.exit_code != 0; });
+        std::cout << "Batch finished in " << std::fixed << std::setprecision(1)
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s, "
+            << jobs.size() - failed << " succeeded, " << failed << " failed" << std::endl;
+        if (!options.batch_summary.empty() && !writeBatchSummary(options.batch_summary, jobs, results)) {
+            std::cerr << "Error writing " << options.batch_summary << std::endl;
+            return 1;
+        }
+        return failed == 0 ? 0 : 1;
+    }
+}
+
+#endif
@@ -0,0 +1,437 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 22:06:15
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 22:06:15
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <fcntl.h>    // For open
+#include <unistd.h>   // For close, fdatasync
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <map>
+#include <optional>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+
+#include "Options.h"
+#include "OrderTable.h"
+#include "SymbolTable.h"
+#include "TradeJournal.h"
+#include "VwapOutput.h"
+#include "BarMetrics.h"
+#include "OrderBook.h"
+
+namespace GuG {
+
+    // Everything a processor shard carries from one message to the next
+    struct ShardState {
+        explicit ShardState(const Options& options)
+            : symbol_table(options.buckets.window), order_table(kBookEnabled ? 0 : options.expected_orders / options.threads),
+            match_journal(options.journal_horizon), order_book(kBookEnabled ? options.expected_orders / options.threads : 0),
+            next_bucket_time(options.buckets.width) {}
+
+        // stock id -> symbol, volume and notional of the open bucket and the rolling window
+        SymbolTable symbol_table;
+        // live orders: order id -> price, remaining shares; left empty with -DGUG_WITH_BOOK
+        OrderTable order_table;
+        // match number -> trade, for Broken Trade messages
+        TradeJournal match_journal;
+        // open bar of every stock, empty without bar metrics
+        TradeBarTable bar_table;
+        // live orders and price levels of every stock, only filled with -DGUG_WITH_BOOK
+        OrderBook order_book;
+        uint32_t cur_bucket = 0u;
+        uint64_t next_bucket_time;
+    };
+
+    // Byte image the tables save themselves into: trivially copyable values and vectors of them
+    // in host byte order, which the checkpoint header records
+    class CheckpointOut {
+    public:
+        template<typename T>
+        void put(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            bytes_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template<typename T>
+        void putVector(const std::vector<T>& values) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            put<uint64_t>(values.size());
+            bytes_.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        }
+
+        std::string& bytes() { return bytes_; }
+
+    private:
+        std::string bytes_;
+    };
+
+    class CheckpointIn {
+    public:
+        CheckpointIn(const char* data, size_t size) : data_(data), left_(size) {}
+
+        template<typename T>
+        void get(T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            take(&value, sizeof(T));
+        }
+
+        template<typename T>
+        void getVector(std::vector<T>& values) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            uint64_t count = 0;
+            get(count);
+            if (count > left_ / sizeof(T)) fail();
+            values.resize(count);
+            take(values.data(), count * sizeof(T));
+        }
+
+        // The saved value must equal the one the table was built with
+        template<typename T>
+        void expect(const T& value) {
+            T saved;
+            get(saved);
+            if (saved != value) fail();
+        }
+
+        [[noreturn]] void fail() { throw std::runtime_error("Corrupt checkpoint"); }
+
+        size_t left() const { return left_; }
+
+    private:
+        void take(void* out, size_t size) {
+            if (size > left_) fail();
+            std::memcpy(out, data_, size);
+            data_ += size;
+            left_ -= size;
+        }
+
+        const char* data_;
+        size_t left_;
+    };
+
+    // File layout: this header, then for every shard its bucket position, SymbolTable,
+    // OrderTable, match journal, bar table, book build flag and order book
+    struct CheckpointHeader {
+        static constexpr char kMagic[8] = { 'G', 'u', 'G', 'C', 'K', 'P', 'T', '\0' };
+        static constexpr uint32_t kVersion = 5;
+        static constexpr uint32_t kByteOrder = 0x01020304;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t input_size;            // size of the feed file
+        uint64_t offset;                // first feed byte the state does not include, a frame boundary
+        uint64_t router_bucket_time;    // ShardRouter::nextBucketTime() at offset
+        uint64_t output_size;           // length of output.csv with the buckets closed before offset
+        uint64_t bucket_width;
+        uint32_t window;
+        uint32_t threads;
+        uint64_t filter[4];             // decoded message types, one bit per type byte
+        uint64_t symbols_checksum;      // FNV-1a of the sorted --symbols list, 0 without one
+        uint64_t payload_size;
+        uint64_t payload_checksum;      // FNV-1a of the shard sections
+    };
+    static_assert(std::is_trivially_copyable_v<CheckpointHeader>);
+
+    namespace detail {
+        inline uint64_t fnv1a(const char* data, size_t size) {
+            uint64_t hash = 0xcbf29ce484222325ULL;
+            for (size_t i = 0; i < size; ++i) {
+                hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ULL;
+            }
+            return hash;
+        }
+
+        // The header fields a run must share with the checkpoint it resumes from
+        inline CheckpointHeader checkpointHeader(const Options& options, uint64_t input_size) {
+            CheckpointHeader header{};
+            std::memcpy(header.magic, CheckpointHeader::kMagic, sizeof(header.magic));
+            header.version = CheckpointHeader::kVersion;
+            header.byte_order = CheckpointHeader::kByteOrder;
+            header.input_size = input_size;
+            header.bucket_width = options.buckets.width;
+            header.window = options.buckets.window;
+            header.threads = static_cast<uint32_t>(options.threads);
+            const MessageFilter filter = makeMessageFilter(options);
+            for (unsigned type = 0; type < 256; ++type) {
+                if (filter.allows(static_cast<char>(type))) {
+                    header.filter[type / 64] |= uint64_t{ 1 } << (type % 64);
+                }
+            }
+            if (!options.symbols.empty()) {
+                std::vector<std::string> symbols = options.symbols;
+                std::sort(symbols.begin(), symbols.end());
+                symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+                std::string list;
+                for (const std::string& symbol : symbols) list += symbol + '\n';
+                header.symbols_checksum = fnv1a(list.data(), list.size());
+            }
+            return header;
+        }
+
+        inline void saveShard(CheckpointOut& out, const ShardState& state) {
+            out.put(state.cur_bucket);
+            out.put(state.next_bucket_time);
+            state.symbol_table.save(out);
+            state.order_table.save(out);
+            state.match_journal.save(out);
+            state.bar_table.save(out);
+            // a book build keeps its orders in the book, so the two builds cannot resume each other
+            out.put(static_cast<uint8_t>(kBookEnabled));
+            state.order_book.save(out);
+        }
+
+        inline void loadShard(CheckpointIn& in, ShardState& state) {
+            in.get(state.cur_bucket);
+            in.get(state.next_bucket_time);
+            state.symbol_table.load(in);
+            state.order_table.load(in);
+            state.match_journal.load(in);
+            state.bar_table.load(in);
+            in.expect(static_cast<uint8_t>(kBookEnabled));
+            state.order_book.load(in);
+        }
+    }
+
+    // A loaded checkpoint: where to pick the feed up again and the state of every shard there
+    struct ResumePoint {
+        CheckpointHeader header;
+        std::vector<ShardState> shards;
+    };
+
+    // Reads the checkpoint at path and checks it was taken on this input with options that give
+    // the same state. Throws std::runtime_error otherwise.
+    ResumePoint loadCheckpoint(const std::string& path, const Options& options, uint64_t input_size) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open checkpoint " + path);
+        }
+        std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        ResumePoint point{};
+        if (bytes.size() < sizeof(CheckpointHeader)) {
+            throw std::runtime_error("Corrupt checkpoint");
+        }
+        std::memcpy(&point.header, bytes.data(), sizeof(CheckpointHeader));
+        const CheckpointHeader& header = point.header;
+        if (std::memcmp(header.magic, CheckpointHeader::kMagic, sizeof(header.magic)) != 0
+            || header.version != CheckpointHeader::kVersion || header.byte_order != CheckpointHeader::kByteOrder) {
+            throw std::runtime_error("Not a checkpoint of this version and byte order");
+        }
+        const char* payload = bytes.data() + sizeof(CheckpointHeader);
+        if (header.payload_size != bytes.size() - sizeof(CheckpointHeader)
+            || header.payload_checksum != detail::fnv1a(payload, header.payload_size)) {
+            throw std::runtime_error("Corrupt checkpoint");
+        }
+        const CheckpointHeader expected = detail::checkpointHeader(options, input_size);
+        if (header.input_size != expected.input_size || header.offset > header.input_size) {
+            throw std::runtime_error("Checkpoint was taken on a different input file");
+        }
+        if (header.bucket_width != expected.bucket_width || header.window != expected.window
+            || header.threads != expected.threads || std::memcmp(header.filter, expected.filter, sizeof(header.filter)) != 0
+            || header.symbols_checksum != expected.symbols_checksum) {
+            throw std::runtime_error("Checkpoint was taken with different --threads, --bucket, --window, --filter, --order-tracking or --symbols");
+        }
+
+        CheckpointIn in(payload, header.payload_size);
+        for (uint32_t i = 0; i < header.threads; ++i) {
+            point.shards.emplace_back(options);
+            detail::loadShard(in, point.shards.back());
+        }
+        if (in.left() != 0) {
+            in.fail();
+        }
+        return point;
+    }
+
+    // Periodic checkpoints of a run over a mapped file, and the state a resumed run starts from.
+    // Every options.checkpoint_interval the reader starts a checkpoint at a frame boundary and
+    // puts a kCheckpointTick behind the frames before it on every shard. A shard copies its state
+    // when it reaches the tick and carries on, so processing only stops for a copy of the flat
+    // tables. Once every shard has, the output writer syncs the rows closed so far and a
+    // background thread serialises the copies and replaces the checkpoint file; a checkpoint
+    // is only started when the previous one is written, so at most one copy is held.
+    class Checkpointer {
+    public:
+        Checkpointer(const Options& options, uint64_t input_size, AsyncVwapWriter& writer, std::optional<ResumePoint> resume = {})
+            : path_(options.checkpoint_path), interval_(options.checkpoint_interval), shard_count_(options.threads),
+            header_(detail::checkpointHeader(options, input_size)), writer_(writer), resume_(std::move(resume)),
+            last_(std::chrono::steady_clock::now()) {
+            if (resume_) {
+                for (const ShardState& state : resume_->shards) {
+                    for (size_t locate = 0; locate < state.symbol_table.size(); ++locate) {
+                        if (state.symbol_table.listed(static_cast<uint16_t>(locate))) {
+                            resume_locates_.push_back(static_cast<uint16_t>(locate));
+                        }
+                    }
+                }
+            }
+            if (!path_.empty()) {
+                thread_ = std::thread([this] { run(); });
+            }
+        }
+
+        ~Checkpointer() { close(); }
+
+        Checkpointer(const Checkpointer&) = delete;
+        Checkpointer& operator=(const Checkpointer&) = delete;
+
+        // Resuming: feed offset and router state to start from
+        bool resuming() const { return resume_.has_value(); }
+        uint64_t resumeOffset() const { return resume_->header.offset; }
+        uint64_t resumeBucketTime() const { return resume_->header.router_bucket_time; }
+
+        // Resuming: stocks with a directory entry before the checkpoint. With --symbols these
+        // are the selected stocks resolved so far, the reader's filter starts from them.
+        const std::vector<uint16_t>& resumeLocates() const { return resume_locates_; }
+
+        // Resuming: the state shard starts from, a fresh one otherwise
+        ShardState takeState(size_t shard, const Options& options) {
+            if (!resume_) return ShardState(options);
+            return std::move(resume_->shards[shard]);
+        }
+
+        // Reader side: true when a checkpoint should be started at the current frame boundary
+        bool due() {
+            if (path_.empty()) return false;
+            std::lock_guard<std::mutex> lock(mutex_);
+            return pending_.empty() && !writing_ && std::chrono::steady_clock::now() - last_ >= interval_;
+        }
+
+        // Reader side: starts a checkpoint at offset and returns the id its ticks carry
+        uint16_t begin(uint64_t offset, uint64_t router_bucket_time) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            uint16_t id = next_id_++;
+            Pending& pending = pending_[id];
+            pending.header = header_;
+            pending.header.offset = offset;
+            pending.header.router_bucket_time = router_bucket_time;
+            return id;
+        }
+
+        // Shard side, on a kCheckpointTick: copies the state into checkpoint id
+        void submit(uint16_t id, size_t shard, const ShardState& state) {
+            auto copy = std::make_unique<ShardState>(state);
+            std::lock_guard<std::mutex> lock(mutex_);
+            Pending& pending = pending_.at(id);
+            pending.shards.resize(shard_count_);
+            pending.shards[shard] = std::move(copy);
+            if (++pending.submitted < shard_count_) {
+                return;
+            }
+            // every bucket closed before the tick has been handed to the writer by now
+            writer_.mark([this, id](uint64_t output_size)
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    Pending& synced = pending_.at(id);
+                    synced.header.output_size = output_size;
+                    synced.synced = true;
+                    ready_.notify_one();
+                });
+        }
+
+        // Waits for the checkpoints in flight; the writer must have been closed first
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (closed_) return;
+                closed_ = true;
+            }
+            ready_.notify_one();
+            if (thread_.joinable()) thread_.join();
+        }
+
+    private:
+        struct Pending {
+            CheckpointHeader header;
+            std::vector<std::unique_ptr<ShardState>> shards;
+            size_t submitted = 0;
+            bool synced = false;
+        };
+
+        void run() {
+            while (true) {
+                Pending pending;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    auto synced = [this] {
+                        for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+                            if (it->second.synced) return it;
+                        }
+                        return pending_.end();
+                    };
+                    ready_.wait(lock, [&] { return closed_ || synced() != pending_.end(); });
+                    auto it = synced();
+                    if (it == pending_.end()) break;  // closed and drained
+                    pending = std::move(it->second);
+                    pending_.erase(it);
+                    writing_ = true;
+                }
+                write(pending);
+                std::lock_guard<std::mutex> lock(mutex_);
+                writing_ = false;
+                last_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        // The checkpoint is written next to path_ and renamed over it, so path_ always holds a
+        // complete checkpoint
+        void write(Pending& pending) {
+            CheckpointOut out;
+            out.bytes().resize(sizeof(CheckpointHeader));
+            for (const auto& shard : pending.shards) {
+                detail::saveShard(out, *shard);
+            }
+            pending.shards.clear();
+            std::string& bytes = out.bytes();
+            pending.header.payload_size = bytes.size() - sizeof(CheckpointHeader);
+            pending.header.payload_checksum = detail::fnv1a(bytes.data() + sizeof(CheckpointHeader), pending.header.payload_size);
+            std::memcpy(bytes.data(), &pending.header, sizeof(CheckpointHeader));
+
+            std::string temp_path = path_ + ".tmp";
+            int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            bool written = fd != -1 && detail::writeAll(fd, bytes.data(), bytes.size()) && ::fdatasync(fd) == 0;
+            if (fd != -1 && ::close(fd) == -1) written = false;
+            if (!written || std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+                std::cerr << "Error writing checkpoint " << path_ << "\n";
+                return;
+            }
+            std::cout << "Checkpoint at " << (pending.header.offset >> 20) << " MB written\n";
+        }
+
+        const std::string path_;
+        const std::chrono::nanoseconds interval_;
+        const size_t shard_count_;
+        const CheckpointHeader header_;
+        AsyncVwapWriter& writer_;
+        std::optional<ResumePoint> resume_;
+        std::vector<uint16_t> resume_locates_;
+        std::mutex mutex_;
+        std::condition_variable ready_;
+        std::map<uint16_t, Pending> pending_;
+        uint16_t next_id_ = 0;
+        bool writing_ = false;
+        bool closed_ = false;
+        std::chrono::steady_clock::time_point last_;  // last checkpoint written, or the start
+        std::thread thread_;
+    };
+}
+
+#endif
@@ -0,0 +1,549 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 22:41:09
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 22:41:09
+ */
+
+#ifndef FEED_INDEX_H
+#define FEED_INDEX_H
+
+#include <fcntl.h>    // For open
+#include <unistd.h>   // For close, unlink
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Utility.h"
+#include "Message.h"
+#include "FrameParser.h"
+#include "OrderTable.h"
+#include "SymbolTable.h"
+#include "TimeBuckets.h"
+#include "VwapOutput.h"
+#include "MemoryMappedFileReader.h"
+
+namespace GuG {
+
+    // Sidecar index of an ITCH file, so a question about one symbol and time range replays only
+    // that part of the file. Layout, native byte order, every section on a 64-byte boundary:
+    //   FeedIndexHeader
+    //   uint64_t[bucket_count + 1]: offset of the first frame at or after each interval start,
+    //   then the end of the last complete frame
+    //   FeedIndexSymbol[symbol_count]: the stock directory with day statistics, in stock id order
+    //   uint64_t[locate_count + 1]: where each stock locate's orders start in the order section
+    //   FeedIndexOrder[order_count]: orders executed (E) in a later interval than they were added
+    //   in, by locate and then by the interval they were added in
+    // An execution (E) takes its price from the order, so a replay that starts at an interval
+    // boundary needs the orders added before it and executed after it; all other state is
+    // rebuilt from the replayed frames.
+    struct FeedIndexHeader {
+        static constexpr char kMagic[8] = { 'G', 'u', 'G', 'I', 'N', 'D', 'X', '\0' };
+        static constexpr uint32_t kVersion = 1;
+        static constexpr uint32_t kByteOrder = 0x01020304;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t input_size;            // size of the indexed file
+        uint64_t interval;              // ns between bucket offsets
+        uint64_t bucket_count;
+        uint64_t bucket_offsets_offset;
+        uint64_t symbol_count;
+        uint64_t symbols_offset;
+        uint64_t locate_count;
+        uint64_t order_ranges_offset;
+        uint64_t order_count;
+        uint64_t orders_offset;
+        uint64_t file_size;
+    };
+
+    // A stock directory entry and what the stock did over the day. Trades count like the VWAP:
+    // executions at the resting order's price, printable executions with price, non-cross and
+    // cross trades; broken trades are not taken back.
+    struct FeedIndexSymbol {
+        StockSymbol symbol;         // last symbol the locate was listed under
+        uint16_t stock_id;
+        uint16_t reserved;
+        uint32_t low;               // lowest and highest trade price, 0 without trades
+        uint32_t high;
+        uint32_t reserved2;
+        uint64_t messages;          // decoded messages with the stock's locate
+        uint64_t trades;
+        uint64_t volume;
+        uint64_t notional;
+        uint64_t last_trade_time;
+    };
+
+    struct FeedIndexOrder {
+        uint64_t order_id;
+        uint32_t price;
+        uint32_t shares;            // when added
+        uint32_t added;             // interval the order was added in
+        uint32_t last_executed;     // interval of its last execution
+        uint16_t stock_id;
+        uint16_t reserved;
+        uint32_t reserved2;
+    };
+
+    static_assert(sizeof(FeedIndexSymbol) == 64);
+    static_assert(sizeof(FeedIndexOrder) == 32);
+
+    namespace detail {
+        constexpr uint64_t kIndexAlignment = 64;
+
+        constexpr uint64_t alignIndex(uint64_t offset) {
+            return (offset + kIndexAlignment - 1) & ~(kIndexAlignment - 1);
+        }
+
+        inline uint64_t frameTime(const std::byte* body) {
+            const std::byte* time = body + 5;  // type, locate, tracking number
+            return readTimeStamp(time);
+        }
+    }
+
+    // One pass over the mapped file collects the bucket offsets, the stock directory with day
+    // statistics and the orders executed across an interval boundary; write() lays them out in
+    // `path`.tmp and renames it to `path`. Throws std::runtime_error on failure.
+    class FeedIndexBuilder {
+    public:
+        FeedIndexBuilder(const MemoryMappedFileReader& input, uint64_t interval)
+            : input_(input), buckets_{ interval, 0 } {
+            scan();
+        }
+
+        void write(const std::string& path) {
+            // one entry per order, with its last execution
+            std::sort(executed_.begin(), executed_.end(), [](const FeedIndexOrder& a, const FeedIndexOrder& b)
+                {
+                    return std::tie(a.stock_id, a.added, a.order_id, a.last_executed) < std::tie(b.stock_id, b.added, b.order_id, b.last_executed);
+                });
+            std::vector<FeedIndexOrder> orders;
+            for (const FeedIndexOrder& order : executed_) {
+                if (!orders.empty() && orders.back().order_id == order.order_id && orders.back().stock_id == order.stock_id) {
+                    orders.back().last_executed = order.last_executed;
+                }
+                else {
+                    orders.push_back(order);
+                }
+            }
+            const uint64_t locate_count = symbols_.size();
+            std::vector<uint64_t> ranges(locate_count + 1, 0);
+            for (const FeedIndexOrder& order : orders) {
+                ++ranges[order.stock_id + 1];
+            }
+            for (size_t locate = 0; locate < locate_count; ++locate) {
+                ranges[locate + 1] += ranges[locate];
+            }
+            std::vector<FeedIndexSymbol> directory;
+            for (size_t locate = 0; locate < symbols_.size(); ++locate) {
+                if (listed_[locate]) {
+                    directory.push_back(symbols_[locate]);
+                    directory.back().stock_id = static_cast<uint16_t>(locate);
+                }
+            }
+
+            FeedIndexHeader header{};
+            std::memcpy(header.magic, FeedIndexHeader::kMagic, sizeof(header.magic));
+            header.version = FeedIndexHeader::kVersion;
+            header.byte_order = FeedIndexHeader::kByteOrder;
+            header.input_size = input_.size();
+            header.interval = buckets_.width;
+            header.bucket_count = buckets_.perDay();
+            header.bucket_offsets_offset = detail::alignIndex(sizeof(FeedIndexHeader));
+            header.symbol_count = directory.size();
+            header.symbols_offset = detail::alignIndex(header.bucket_offsets_offset + bucket_offsets_.size() * sizeof(uint64_t));
+            header.locate_count = locate_count;
+            header.order_ranges_offset = detail::alignIndex(header.symbols_offset + directory.size() * sizeof(FeedIndexSymbol));
+            header.order_count = orders.size();
+            header.orders_offset = detail::alignIndex(header.order_ranges_offset + ranges.size() * sizeof(uint64_t));
+            header.file_size = header.orders_offset + orders.size() * sizeof(FeedIndexOrder);
+
+            std::string temp_path = path + ".tmp";
+            int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd == -1) {
+                throw std::runtime_error("Error creating " + temp_path);
+            }
+            uint64_t written = 0;
+            auto section = [&](uint64_t offset, const void* data, size_t size)
+                {
+                    static const char padding[detail::kIndexAlignment] = {};
+                    bool ok = detail::writeAll(fd, padding, offset - written)
+                        && detail::writeAll(fd, static_cast<const char*>(data), size);
+                    written = offset + size;
+                    return ok;
+                };
+            bool ok = section(0, &header, sizeof(header))
+                && section(header.bucket_offsets_offset, bucket_offsets_.data(), bucket_offsets_.size() * sizeof(uint64_t))
+                && section(header.symbols_offset, directory.data(), directory.size() * sizeof(FeedIndexSymbol))
+                && section(header.order_ranges_offset, ranges.data(), ranges.size() * sizeof(uint64_t))
+                && section(header.orders_offset, orders.data(), orders.size() * sizeof(FeedIndexOrder));
+            if (::close(fd) == -1) ok = false;
+            if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+                ::unlink(temp_path.c_str());
+                throw std::runtime_error("Error writing " + path);
+            }
+        }
+
+    private:
+        void scan() {
+            const std::byte* begin = static_cast<const std::byte*>(input_.data());
+            const std::byte* end = begin + input_.size();
+            const uint64_t bucket_count = buckets_.perDay();
+            const MessageFilter filter = MessageFilter::vwap(true);
+            ItchMessageRecord message;
+            bucket_offsets_.reserve(bucket_count + 1);
+
+            const std::byte* frame = begin;
+            while (static_cast<size_t>(end - frame) >= kFrameHeaderSize) {
+                size_t length = frameLength(frame);
+                const std::byte* body = frame + kFrameHeaderSize;
+                if (static_cast<size_t>(end - body) < length) break;
+                const std::byte* next = body + length;
+                char type = length == 0 ? '\0' : static_cast<char>(body[0]);
+                if (length == 0 || MessageFactory::getMessageSize(type) + 1 != length) {
+                    frame = next;
+                    continue;
+                }
+                uint64_t time = detail::frameTime(body);
+                while (bucket_offsets_.size() < bucket_count && time >= buckets_.start(static_cast<uint32_t>(bucket_offsets_.size()))) {
+                    bucket_offsets_.push_back(frame - begin);
+                }
+                frame = next;
+
+                const std::byte* data = body + 1;
+                if (filter.allows(type) && MessageFactory::createMessage(type, data, message)) {
+                    apply(frameLocate(body), time, message);
+                }
+            }
+            while (bucket_offsets_.size() <= bucket_count) {
+                bucket_offsets_.push_back(frame - begin);
+            }
+        }
+
+        void apply(uint16_t locate, uint64_t time, const ItchMessageRecord& message) {
+            if (locate >= symbols_.size()) {
+                symbols_.resize(static_cast<size_t>(locate) + 1, FeedIndexSymbol{});
+                listed_.resize(symbols_.size(), 0);
+            }
+            ++symbols_[locate].messages;
+            const uint32_t bucket = buckets_.index(time);
+            switch (messageHeader(message).message_type) {
+            case 'R':
+                symbols_[locate].symbol = std::get<StockDirectoryMessage>(message).stock_symbol;
+                listed_[locate] = 1;
+                break;
+            case 'A': {
+                const auto& order = std::get<AddOrderMessage>(message);
+                add(order.order_id, order.price, order.shares, bucket);
+                break;
+            }
+            case 'F': {
+                const auto& order = std::get<AddOrderMPIDAttributionMessage>(message);
+                add(order.order_id, order.price, static_cast<uint32_t>(order.shares), bucket);
+                break;
+            }
+            case 'E': {
+                const auto& executed = std::get<OrderExecutedMessage>(message);
+                const OrderEntry* order = book_.find(executed.order_id);
+                const OrderEntry* added = added_.find(executed.order_id);
+                if (order != nullptr && added != nullptr && added->price < bucket) {
+                    executed_.push_back({ executed.order_id, order->price, added->shares, added->price, bucket, locate, 0, 0 });
+                }
+                trade(locate, time, reduce(executed.order_id, executed.executed_shares), executed.executed_shares);
+                break;
+            }
+            case 'C': {
+                const auto& executed = std::get<OrderExecutedWithPriceMessage>(message);
+                reduce(executed.order_id, executed.executed_shares);
+                if (executed.printable != 'N') trade(locate, time, executed.execution_price, executed.executed_shares);
+                break;
+            }
+            case 'U': {
+                const auto& replace = std::get<OrderReplaceMessage>(message);
+                erase(replace.original_order_id);
+                add(replace.new_order_id, replace.price, replace.shares, bucket);
+                break;
+            }
+            case 'X': {
+                const auto& cancel = std::get<OrderCancelMessage>(message);
+                reduce(cancel.order_id, cancel.cancelled_shares);
+                break;
+            }
+            case 'D':
+                erase(std::get<OrderDeleteMessage>(message).order_id);
+                break;
+            case 'P': {
+                const auto& cross = std::get<NonCrossTradeMessage>(message);
+                trade(locate, time, cross.price, cross.shares);
+                break;
+            }
+            case 'Q': {
+                const auto& cross = std::get<CrossTradeMessage>(message);
+                trade(locate, time, cross.cross_price, cross.shares);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        void add(uint64_t order_id, uint32_t price, uint32_t shares, uint32_t bucket) {
+            book_.insert(order_id, price, shares);
+            added_.insert(order_id, bucket, shares);
+        }
+
+        uint32_t reduce(uint64_t order_id, uint32_t shares) {
+            uint32_t price = book_.reduce(order_id, shares);
+            if (price != 0 && book_.find(order_id) == nullptr) added_.erase(order_id);
+            return price;
+        }
+
+        void erase(uint64_t order_id) {
+            book_.erase(order_id);
+            added_.erase(order_id);
+        }
+
+        void trade(uint16_t locate, uint64_t time, uint32_t price, uint64_t shares) {
+            FeedIndexSymbol& stats = symbols_[locate];
+            if (stats.trades++ == 0 || price < stats.low) stats.low = price;
+            stats.high = std::max(stats.high, price);
+            stats.volume += shares;
+            stats.notional += static_cast<uint64_t>(price) * shares;
+            stats.last_trade_time = time;
+        }
+
+        const MemoryMappedFileReader& input_;
+        const TimeBuckets buckets_;
+        std::vector<uint64_t> bucket_offsets_;
+        std::vector<FeedIndexSymbol> symbols_;  // by locate
+        std::vector<uint8_t> listed_;
+        OrderTable book_;
+        OrderTable added_;                      // the same orders: interval added in (as price), shares when added
+        std::vector<FeedIndexOrder> executed_;  // an entry per execution in a later interval than the add
+    };
+
+    // A mapped index, checked against the file it was built for
+    class FeedIndex {
+    public:
+        FeedIndex(const char* filepath, const MemoryMappedFileReader& input) : file_(filepath) {
+            base_ = static_cast<const char*>(file_.data());
+            if (file_.size() < sizeof(FeedIndexHeader)) {
+                throw std::runtime_error("Not a feed index");
+            }
+            std::memcpy(&header_, base_, sizeof(header_));
+            if (std::memcmp(header_.magic, FeedIndexHeader::kMagic, sizeof(header_.magic)) != 0) {
+                throw std::runtime_error("Not a feed index");
+            }
+            if (header_.version != FeedIndexHeader::kVersion || header_.byte_order != FeedIndexHeader::kByteOrder) {
+                throw std::runtime_error("Unsupported feed index version or byte order");
+            }
+            bool valid = header_.file_size == file_.size() && header_.interval != 0
+                && header_.bucket_count == TimeBuckets{ header_.interval, 0 }.perDay() && header_.locate_count <= UINT16_MAX + 1
+                && fits(header_.bucket_offsets_offset, (header_.bucket_count + 1) * sizeof(uint64_t))
+                && fits(header_.symbols_offset, header_.symbol_count * sizeof(FeedIndexSymbol))
+                && fits(header_.order_ranges_offset, (header_.locate_count + 1) * sizeof(uint64_t))
+                && fits(header_.orders_offset, header_.order_count * sizeof(FeedIndexOrder));
+            if (valid) {
+                for (uint64_t offset : bucketOffsets()) valid = valid && offset <= header_.input_size;
+                std::span<const uint64_t> ranges = orderRanges();
+                for (size_t i = 1; i < ranges.size(); ++i) valid = valid && ranges[i - 1] <= ranges[i];
+                valid = valid && ranges.back() == header_.order_count;
+            }
+            if (!valid) {
+                throw std::runtime_error("Corrupt feed index");
+            }
+            if (header_.input_size != input.size()) {
+                throw std::runtime_error("Index was built for a different input file");
+            }
+        }
+
+        FeedIndex(const FeedIndex&) = delete;
+        FeedIndex& operator=(const FeedIndex&) = delete;
+
+        const FeedIndexHeader& header() const { return header_; }
+        TimeBuckets buckets() const { return TimeBuckets{ header_.interval, 0 }; }
+
+        // Offset of the first frame at or after the start of each interval, then the feed's end
+        std::span<const uint64_t> bucketOffsets() const {
+            return { reinterpret_cast<const uint64_t*>(base_ + header_.bucket_offsets_offset), header_.bucket_count + 1 };
+        }
+
+        // The stock directory in stock id order
+        std::span<const FeedIndexSymbol> symbols() const {
+            return { reinterpret_cast<const FeedIndexSymbol*>(base_ + header_.symbols_offset), header_.symbol_count };
+        }
+
+        const FeedIndexSymbol* find(std::string_view symbol) const {
+            for (const FeedIndexSymbol& entry : symbols()) {
+                if (entry.symbol.view() == symbol) return &entry;
+            }
+            return nullptr;
+        }
+
+        // Orders of a stock executed in a later interval than they were added in, by interval added
+        std::span<const FeedIndexOrder> orders(uint16_t stock_id) const {
+            if (stock_id >= header_.locate_count) return {};
+            std::span<const uint64_t> ranges = orderRanges();
+            return { reinterpret_cast<const FeedIndexOrder*>(base_ + header_.orders_offset) + ranges[stock_id],
+                ranges[stock_id + 1] - ranges[stock_id] };
+        }
+
+    private:
+        bool fits(uint64_t offset, uint64_t size) const {
+            return offset % detail::kIndexAlignment == 0 && offset <= file_.size() && size <= file_.size() - offset;
+        }
+
+        std::span<const uint64_t> orderRanges() const {
+            return { reinterpret_cast<const uint64_t*>(base_ + header_.order_ranges_offset), header_.locate_count + 1 };
+        }
+
+        MemoryMappedFileReader file_;
+        const char* base_ = nullptr;
+        FeedIndexHeader header_;
+    };
+
+    struct VwapQuery {
+        uint16_t stock_id;
+        uint64_t from;  // ns after midnight, inclusive
+        uint64_t to;    // exclusive
+    };
+
+    struct VwapQueryResult {
+        VolumeAccumulator total;
+        uint64_t trades = 0;
+        uint64_t replayed = 0;  // bytes of the file replayed
+    };
+
+    // VWAP of one stock over [from, to), counted like output.csv. Replays the file from the index
+    // interval holding `from` up to `to`, decoding only the stock's frames, with the orders that
+    // are executed after that interval starts seeded from the index. Seeded orders carry the
+    // shares they were added with, which keeps them at least as long as the full replay would.
+    // A broken trade is taken back if the trade and the break both fall in the range.
+    VwapQueryResult queryVwap(const FeedIndex& index, const MemoryMappedFileReader& input, const VwapQuery& query) {
+        VwapQueryResult result;
+        const TimeBuckets buckets = index.buckets();
+        const uint32_t first = std::min<uint64_t>(buckets.index(query.from), index.header().bucket_count);
+        const uint32_t last = std::min<uint64_t>(buckets.index(query.to + buckets.width - 1), index.header().bucket_count);
+        OrderTable book(1024);
+        for (const FeedIndexOrder& order : index.orders(query.stock_id)) {
+            if (order.added >= first) break;
+            if (order.last_executed >= first) book.insert(order.order_id, order.price, order.shares);
+        }
+        // match number -> price, shares of the trades in the range
+        std::unordered_map<uint64_t, std::pair<uint32_t, uint64_t>> journal;
+        auto trade = [&](uint64_t time, uint64_t match, uint32_t price, uint64_t shares)
+            {
+                if (time < query.from) return;
+                result.total.add(price, shares);
+                ++result.trades;
+                journal[match] = { price, shares };
+            };
+
+        const std::byte* base = static_cast<const std::byte*>(input.data());
+        const std::byte* start = base + index.bucketOffsets()[first];
+        const std::byte* end = base + index.bucketOffsets()[last];
+        const MessageFilter filter = MessageFilter::vwap(true);
+        ItchMessageRecord message;
+        const std::byte* frame = start;
+        while (static_cast<size_t>(end - frame) >= kFrameHeaderSize) {
+            size_t length = frameLength(frame);
+            const std::byte* body = frame + kFrameHeaderSize;
+            if (static_cast<size_t>(end - body) < length) break;
+            frame = body + length;
+            if (length < 3 || frameLocate(body) != query.stock_id) continue;
+            char type = static_cast<char>(body[0]);
+            const std::byte* data = body + 1;
+            if (MessageFactory::getMessageSize(type) + 1 != length || !filter.allows(type)
+                || !MessageFactory::createMessage(type, data, message)) {
+                continue;
+            }
+            uint64_t time = messageHeader(message).message_time;
+            if (time >= query.to) break;
+            switch (type) {
+            case 'A': {
+                const auto& add = std::get<AddOrderMessage>(message);
+                book.insert(add.order_id, add.price, add.shares);
+                break;
+            }
+            case 'F': {
+                const auto& add = std::get<AddOrderMPIDAttributionMessage>(message);
+                book.insert(add.order_id, add.price, static_cast<uint32_t>(add.shares));
+                break;
+            }
+            case 'E': {
+                const auto& executed = std::get<OrderExecutedMessage>(message);
+                uint32_t price = book.reduce(executed.order_id, executed.executed_shares);
+                trade(time, executed.match_number, price, executed.executed_shares);
+                break;
+            }
+            case 'C': {
+                const auto& executed = std::get<OrderExecutedWithPriceMessage>(message);
+                book.reduce(executed.order_id, executed.executed_shares);
+                if (executed.printable != 'N') trade(time, executed.match_number, executed.execution_price, executed.executed_shares);
+                break;
+            }
+            case 'U': {
+                const auto& replace = std::get<OrderReplaceMessage>(message);
+                book.erase(replace.original_order_id);
+                book.insert(replace.new_order_id, replace.price, replace.shares);
+                break;
+            }
+            case 'X': {
+                const auto& cancel = std::get<OrderCancelMessage>(message);
+                book.reduce(cancel.order_id, cancel.cancelled_shares);
+                break;
+            }
+            case 'D':
+                book.erase(std::get<OrderDeleteMessage>(message).order_id);
+                break;
+            case 'P': {
+                const auto& cross = std::get<NonCrossTradeMessage>(message);
+                trade(time, cross.match_number, cross.price, cross.shares);
+                break;
+            }
+            case 'Q': {
+                const auto& cross = std::get<CrossTradeMessage>(message);
+                trade(time, cross.match_number, cross.cross_price, cross.shares);
+                break;
+            }
+            case 'B': {
+                auto it = journal.find(std::get<BrokenTradeMessage>(message).match_number);
+                if (it != journal.end()) {
+                    result.total.remove(it->second.first, it->second.second);
+                    --result.trades;
+                    journal.erase(it);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        result.replayed = static_cast<uint64_t>(frame - start);
+        return result;
+    }
+
+    // HH:MM:SS, with .mmm when time is not a whole second
+    inline std::string formatClock(uint64_t time) {
+        char text[16];
+        uint64_t seconds = time / 1000000000ULL;
+        int size = std::snprintf(text, sizeof(text), "%02u:%02u:%02u", static_cast<unsigned>(seconds / 3600),
+            static_cast<unsigned>(seconds / 60 % 60), static_cast<unsigned>(seconds % 60));
+        if (time % 1000000000ULL != 0) {
+            std::snprintf(text + size, sizeof(text) - size, ".%03u", static_cast<unsigned>(time / 1000000ULL % 1000));
+        }
+        return text;
+    }
+}
+
+#endif
@@ -0,0 +1,371 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 23:31:52
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 23:31:52
+ */
+
+#ifndef FILE_BLOCK_READER_H
+#define FILE_BLOCK_READER_H
+
+#include <sys/mman.h>     // For mmap of the io_uring rings
+#include <sys/stat.h>     // For fstat
+#include <sys/syscall.h>  // For the io_uring system calls
+#include <fcntl.h>        // For open
+#include <unistd.h>       // For pread, close
+#include <linux/io_uring.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+#include <stdexcept>
+
+namespace GuG {
+
+    // How FileBlockReader reads the file
+    enum class ReadBackend {
+        Pread,   // a background thread pread()s blocks ahead of the parser
+        Direct,  // the same with O_DIRECT: no page cache, no copy into it
+        Uring    // io_uring reads queued ahead of the parser, no extra thread
+    };
+
+    namespace detail {
+        struct AlignedFree {
+            void operator()(std::byte* p) const { std::free(p); }
+        };
+
+        // Minimal io_uring over the raw system calls: one read per submission, completions
+        // carry the block index as user_data. Throws std::runtime_error where io_uring is missing.
+        class Uring {
+        public:
+            explicit Uring(unsigned entries) {
+                io_uring_params params{};
+                fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+                if (fd_ == -1) {
+                    throw std::runtime_error(std::string("io_uring is not available: ") + std::strerror(errno));
+                }
+                sq_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+                cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                if (params.features & IORING_FEAT_SINGLE_MMAP) {
+                    sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+                }
+                sq_ring_ = map(sq_size_, IORING_OFF_SQ_RING);
+                cq_ring_ = (params.features & IORING_FEAT_SINGLE_MMAP) ? sq_ring_ : map(cq_size_, IORING_OFF_CQ_RING);
+                sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+                sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+
+                char* sq = static_cast<char*>(sq_ring_);
+                sq_tail_ = reinterpret_cast<std::atomic<uint32_t>*>(sq + params.sq_off.tail);
+                sq_mask_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+                sq_array_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+                char* cq = static_cast<char*>(cq_ring_);
+                cq_head_ = reinterpret_cast<std::atomic<uint32_t>*>(cq + params.cq_off.head);
+                cq_tail_ = reinterpret_cast<std::atomic<uint32_t>*>(cq + params.cq_off.tail);
+                cq_mask_ = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+                cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            }
+
+            ~Uring() {
+                if (sqes_ != nullptr) ::munmap(sqes_, sqes_size_);
+                if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_size_);
+                if (sq_ring_ != nullptr) ::munmap(sq_ring_, sq_size_);
+                if (fd_ != -1) ::close(fd_);
+            }
+
+            Uring(const Uring&) = delete;
+            Uring& operator=(const Uring&) = delete;
+
+            // Queues a read; submitted by the next wait()
+            void read(int fd, std::byte* buffer, uint32_t size, uint64_t offset, uint64_t user_data) {
+                uint32_t tail = sq_tail_->load(std::memory_order_relaxed);
+                io_uring_sqe& sqe = sqes_[tail & sq_mask_];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = fd;
+                sqe.addr = reinterpret_cast<uint64_t>(buffer);
+                sqe.len = size;
+                sqe.off = offset;
+                sqe.user_data = user_data;
+                sq_array_[tail & sq_mask_] = tail & sq_mask_;
+                sq_tail_->store(tail + 1, std::memory_order_release);
+                ++unsubmitted_;
+            }
+
+            // Submits the queued reads and waits for one completion: (user_data, result)
+            std::pair<uint64_t, int32_t> wait() {
+                while (true) {
+                    uint32_t head = cq_head_->load(std::memory_order_relaxed);
+                    if (head != cq_tail_->load(std::memory_order_acquire)) {
+                        const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                        std::pair<uint64_t, int32_t> completion{ cqe.user_data, cqe.res };
+                        cq_head_->store(head + 1, std::memory_order_release);
+                        return completion;
+                    }
+                    long result = ::syscall(__NR_io_uring_enter, fd_, unsubmitted_, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                    if (result == -1) {
+                        if (errno == EINTR) continue;
+                        throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(errno));
+                    }
+                    unsubmitted_ -= static_cast<unsigned>(result);
+                }
+            }
+
+        private:
+            void* map(size_t size, off_t offset) {
+                void* ring = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+                if (ring == MAP_FAILED) {
+                    throw std::runtime_error("Error mapping the io_uring rings");
+                }
+                return ring;
+            }
+
+            int fd_ = -1;
+            void* sq_ring_ = nullptr;
+            void* cq_ring_ = nullptr;
+            io_uring_sqe* sqes_ = nullptr;
+            size_t sq_size_ = 0;
+            size_t cq_size_ = 0;
+            size_t sqes_size_ = 0;
+            std::atomic<uint32_t>* sq_tail_ = nullptr;
+            uint32_t sq_mask_ = 0;
+            uint32_t* sq_array_ = nullptr;
+            std::atomic<uint32_t>* cq_head_ = nullptr;
+            std::atomic<uint32_t>* cq_tail_ = nullptr;
+            uint32_t cq_mask_ = 0;
+            io_uring_cqe* cqes_ = nullptr;
+            unsigned unsubmitted_ = 0;
+        };
+    }
+
+    // Reads a plain feed file into a ring of `depth` blocks with explicit reads instead of a
+    // mapping, so the process only ever holds depth blocks of it: the parser works on one block
+    // while the next ones are read. Same interface as GzipReader: run() hands the blocks over in
+    // order, with the frame cut at the end of a block carried into the space before the next.
+    class FileBlockReader {
+    public:
+        // A frame is at most 2 + 65535 bytes; rounded up to keep O_DIRECT buffers aligned
+        static constexpr size_t kAlignment = 4096;
+        static constexpr size_t kCarrySize = 17 * kAlignment;
+
+        FileBlockReader(const char* filepath, ReadBackend backend, size_t block_size, size_t depth)
+            : backend_(backend), block_size_(std::max((block_size + kAlignment - 1) / kAlignment * kAlignment, kAlignment)),
+            depth_(std::max<size_t>(depth, 2)) {
+            fd_ = ::open(filepath, O_RDONLY);
+            if (fd_ == -1) {
+                throw std::runtime_error("Error opening file");
+            }
+            struct stat sb;
+            if (::fstat(fd_, &sb) == -1) {
+                ::close(fd_);
+                throw std::runtime_error("Error getting file size");
+            }
+            size_ = static_cast<size_t>(sb.st_size);
+            read_fd_ = fd_;
+            if (backend_ == ReadBackend::Direct) {
+                read_fd_ = ::open(filepath, O_RDONLY | O_DIRECT);
+                if (read_fd_ == -1) {
+                    ::close(fd_);
+                    throw std::runtime_error("O_DIRECT is not supported for this file");
+                }
+            }
+            else {
+                ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+        }
+
+        ~FileBlockReader() {
+            if (read_fd_ != fd_ && read_fd_ != -1) ::close(read_fd_);
+            if (fd_ != -1) ::close(fd_);
+        }
+
+        FileBlockReader(const FileBlockReader&) = delete;
+        FileBlockReader& operator=(const FileBlockReader&) = delete;
+
+        size_t size() const { return size_; }
+
+        // Calls consume(begin, end) for every block in order. consume returns the start of the
+        // bytes it did not use (an incomplete frame), which are passed again in front of the next
+        // block. Throws std::runtime_error on read errors.
+        template<typename Consume>
+        void run(Consume&& consume) {
+            blocks_.clear();
+            for (size_t i = 0; i < depth_; ++i) {
+                void* storage = std::aligned_alloc(kAlignment, kCarrySize + block_size_);
+                if (storage == nullptr) throw std::bad_alloc();
+                blocks_.push_back(Block{ std::unique_ptr<std::byte, detail::AlignedFree>(static_cast<std::byte*>(storage)) });
+            }
+            const size_t block_count = (size_ + block_size_ - 1) / block_size_;
+            std::vector<std::byte> carry;
+            auto parse = [&](Block& block) {
+                std::byte* payload = block.storage.get() + kCarrySize;
+                std::byte* begin = payload - carry.size();
+                std::memcpy(begin, carry.data(), carry.size());
+                const std::byte* end = payload + block.size;
+                const std::byte* rest = consume(static_cast<const std::byte*>(begin), end);
+                if (static_cast<size_t>(end - rest) > kCarrySize) {
+                    throw std::runtime_error("Unparsable data in input");
+                }
+                carry.assign(rest, end);
+            };
+            if (backend_ == ReadBackend::Uring) {
+                runUring(block_count, parse);
+            }
+            else {
+                runThreaded(block_count, parse);
+            }
+        }
+
+    private:
+        struct Block {
+            std::unique_ptr<std::byte, detail::AlignedFree> storage;  // kCarrySize reserved, then the data
+            size_t size = 0;
+            size_t index = SIZE_MAX;    // block of the file held, SIZE_MAX when free
+        };
+
+        // Reads what a short read left of block_index with plain pread
+        void finishBlock(Block& block, size_t block_index, size_t done) {
+            const uint64_t offset = static_cast<uint64_t>(block_index) * block_size_;
+            const size_t want = std::min(block_size_, size_ - static_cast<size_t>(offset));
+            std::byte* payload = block.storage.get() + kCarrySize;
+            while (done < want) {
+                ssize_t count = ::pread(fd_, payload + done, want - done, static_cast<off_t>(offset + done));
+                if (count == -1 && errno == EINTR) continue;
+                if (count <= 0) throw std::runtime_error("Error reading input");
+                done += static_cast<size_t>(count);
+            }
+            block.size = want;
+        }
+
+        // Pread and Direct: one thread reads blocks into free slots, the caller parses them
+        template<typename Parse>
+        void runThreaded(size_t block_count, Parse& parse) {
+            std::mutex mutex;
+            std::condition_variable block_ready;
+            std::condition_variable block_free;
+            size_t consumed = 0;
+            bool stop = false;
+            std::string error;
+
+            std::thread reader([&] {
+                try {
+                    for (size_t block_index = 0; block_index < block_count; ++block_index) {
+                        Block* block;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            block_free.wait(lock, [&] { return stop || block_index < consumed + depth_; });
+                            if (stop) return;
+                            block = &blocks_[block_index % depth_];
+                        }
+                        const uint64_t offset = static_cast<uint64_t>(block_index) * block_size_;
+                        ssize_t count;
+                        do {
+                            count = ::pread(read_fd_, block->storage.get() + kCarrySize, block_size_, static_cast<off_t>(offset));
+                        } while (count == -1 && errno == EINTR);
+                        if (count < 0) throw std::runtime_error(std::string("Error reading input: ") + std::strerror(errno));
+                        finishBlock(*block, block_index, static_cast<size_t>(count));
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            block->index = block_index;
+                        }
+                        block_ready.notify_all();
+                    }
+                }
+                catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    error = e.what();
+                    stop = true;
+                    block_ready.notify_all();
+                }
+                });
+
+            try {
+                for (size_t block_index = 0; block_index < block_count; ++block_index) {
+                    Block* block;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        block_ready.wait(lock, [&] { return stop || blocks_[block_index % depth_].index == block_index; });
+                        if (stop) break;
+                        block = &blocks_[block_index % depth_];
+                    }
+                    parse(*block);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        block->index = SIZE_MAX;
+                        ++consumed;
+                    }
+                    block_free.notify_all();
+                }
+            }
+            catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stop = true;
+                }
+                block_free.notify_all();
+                reader.join();
+                throw;
+            }
+            reader.join();
+            if (!error.empty()) {
+                throw std::runtime_error(error);
+            }
+        }
+
+        // Uring: the next depth - 1 blocks are always queued while one is parsed
+        template<typename Parse>
+        void runUring(size_t block_count, Parse& parse) {
+            detail::Uring ring(static_cast<unsigned>(depth_));
+            size_t queued = 0;
+            size_t in_flight = 0;
+            auto queue = [&](size_t block_index) {
+                Block& block = blocks_[block_index % depth_];
+                block.index = SIZE_MAX;
+                ring.read(read_fd_, block.storage.get() + kCarrySize, static_cast<uint32_t>(block_size_),
+                    static_cast<uint64_t>(block_index) * block_size_, block_index);
+                ++in_flight;
+            };
+            for (; queued < std::min(depth_, block_count); ++queued) queue(queued);
+            try {
+                for (size_t block_index = 0; block_index < block_count; ++block_index) {
+                    Block& block = blocks_[block_index % depth_];
+                    while (block.index != block_index) {
+                        auto [done, result] = ring.wait();
+                        --in_flight;
+                        if (result < 0) throw std::runtime_error(std::string("Error reading input: ") + std::strerror(-result));
+                        Block& completed = blocks_[done % depth_];
+                        finishBlock(completed, static_cast<size_t>(done), static_cast<size_t>(result));
+                        completed.index = static_cast<size_t>(done);
+                    }
+                    parse(block);
+                    if (queued < block_count) queue(queued++);
+                }
+            }
+            catch (...) {
+                while (in_flight > 0) {  // the kernel may still write into the blocks
+                    ring.wait();
+                    --in_flight;
+                }
+                throw;
+            }
+        }
+
+        const ReadBackend backend_;
+        const size_t block_size_;
+        const size_t depth_;
+        size_t size_ = 0;
+        int fd_ = -1;       // buffered reads, and what a short O_DIRECT read left
+        int read_fd_ = -1;  // fd_, or the O_DIRECT descriptor
+        std::vector<Block> blocks_;
+    };
+}
+
+#endif
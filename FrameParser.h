@@ -0,0 +1,257 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 13:02:18
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 13:02:18
+ */
+
+#ifndef FRAME_PARSER_H
+#define FRAME_PARSER_H
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+
+#include "Message.h"
+#include "MessageFilter.h"
+
+namespace GuG {
+
+    // Every message in a NASDAQ ITCH 5.0 file is preceded by its length as a big-endian uint16
+    constexpr size_t kFrameHeaderSize = 2;
+
+    inline size_t frameLength(const std::byte* frame) {
+        return (static_cast<size_t>(frame[0]) << 8) | static_cast<size_t>(frame[1]);
+    }
+
+    // True if the frame at `frame` fits before `end` and its length matches the spec size of its type
+    inline bool isWellFormedFrame(const std::byte* frame, const std::byte* end) {
+        if (end - frame < static_cast<ptrdiff_t>(kFrameHeaderSize + 1)) return false;
+        size_t length = frameLength(frame);
+        if (static_cast<size_t>(end - frame) - kFrameHeaderSize < length) return false;
+        size_t message_size = MessageFactory::getMessageSize(static_cast<char>(frame[kFrameHeaderSize]));
+        return message_size != 0 && length == message_size + 1;
+    }
+
+    // Stock locate of a frame body, the two bytes after the type
+    inline uint16_t frameLocate(const std::byte* body) {
+        return static_cast<uint16_t>(static_cast<unsigned>(body[1]) << 8 | static_cast<unsigned>(body[2]));
+    }
+
+    // Default on_skip of parseFrames
+    struct IgnoreSkipped {
+        void operator()(char) const {}
+    };
+
+    // Decodes every complete frame in [begin, end) whose type passes the filter and passes the
+    // records to sink in feed order. Frames of unknown types, of types outside the filter or with a
+    // length that does not match their type are skipped whole, and so are frames of stocks the
+    // filter's symbol list does not select.
+    // A skipped message that would have been decoded without the filter can still start a new
+    // VWAP bucket, so the first one of each bucket is forwarded as a tick (a bare ItchMessage with
+    // message_type '\0'): buckets close at the same point of the feed with or without the filter.
+    // on_skip(type) sees the type of every skipped frame.
+    // Returns the start of the first incomplete frame, or end.
+    template<typename Sink, typename OnSkip = IgnoreSkipped>
+    const std::byte* parseFrames(const std::byte* begin, const std::byte* end, Sink&& sink,
+        const MessageFilter& filter = MessageFilter::all(), uint64_t bucket_width = kNanosPerHour,
+        OnSkip&& on_skip = OnSkip{}) {
+        ItchMessageRecord message;
+        uint64_t next_bucket_time = 0u;  // start of the bucket after the last forwarded message
+        auto drop = [&](uint64_t message_time)
+            {
+                if (message_time >= next_bucket_time) {
+                    next_bucket_time = (message_time / bucket_width + 1) * bucket_width;
+                    ItchMessage tick(kBucketTick);
+                    tick.message_time = message_time;
+                    sink(ItchMessageRecord(tick));
+                }
+            };
+        const std::byte* frame = begin;
+        while (static_cast<size_t>(end - frame) >= kFrameHeaderSize) {
+            size_t length = frameLength(frame);
+            const std::byte* body = frame + kFrameHeaderSize;
+            if (static_cast<size_t>(end - body) < length) break;
+            frame = body + length;
+
+            if (length == 0) continue;
+            char msg_type = static_cast<char>(body[0]);
+            if (MessageFactory::getMessageSize(msg_type) + 1 != length) {
+                on_skip(msg_type);
+                continue;
+            }
+            const std::byte* data = body + 1;
+            if (!filter.allows(msg_type) || filter.dropsLocate(msg_type, frameLocate(body))) {
+                on_skip(msg_type);
+                if (!filter.allows(msg_type) && !filter.drops(msg_type)) continue;
+                const std::byte* time = data + 4;
+                drop(readTimeStamp(time));
+                continue;
+            }
+            if (MessageFactory::createMessage(msg_type, data, message)) {
+                uint64_t message_time = messageHeader(message).message_time;
+                if (msg_type == 'R' && !filter.resolve(std::get<StockDirectoryMessage>(message))) {
+                    on_skip(msg_type);
+                    drop(message_time);
+                    continue;
+                }
+                if (message_time >= next_bucket_time) {
+                    next_bucket_time = (message_time / bucket_width + 1) * bucket_width;
+                }
+                sink(std::move(message));
+            }
+        }
+        return frame;
+    }
+
+    // True if [begin, end) holds the End of Messages system event, the last message of a day
+    inline bool hasEndOfMessages(const std::byte* begin, const std::byte* end) {
+        constexpr size_t kEventCodeOffset = 11;  // type, locate, tracking number, timestamp
+        const std::byte* frame = begin;
+        while (static_cast<size_t>(end - frame) >= kFrameHeaderSize) {
+            size_t length = frameLength(frame);
+            const std::byte* body = frame + kFrameHeaderSize;
+            if (static_cast<size_t>(end - body) < length) break;
+            frame = body + length;
+            if (length > kEventCodeOffset && static_cast<char>(body[0]) == 'S'
+                && static_cast<char>(body[kEventCodeOffset]) == 'C') {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // First offset at or after `from` that starts a run of well formed frames, either
+    // kBoundaryFrames long or reaching exactly the end of the data. Returns size if none.
+    size_t findFrameBoundary(const std::byte* data, size_t size, size_t from) {
+        constexpr int kBoundaryFrames = 8;
+        const std::byte* end = data + size;
+        for (size_t offset = from; offset < size; ++offset) {
+            const std::byte* frame = data + offset;
+            int frames = 0;
+            while (frames < kBoundaryFrames && isWellFormedFrame(frame, end)) {
+                frame += kFrameHeaderSize + frameLength(frame);
+                ++frames;
+            }
+            if (frames == kBoundaryFrames || (frames > 0 && frame == end)) {
+                return offset;
+            }
+        }
+        return size;
+    }
+
+    // Splits a mapped file into chunks cut at frame boundaries, decodes the chunks on worker
+    // threads and hands the records to the sink in the original order of the file.
+    // At most 2 * threads decoded chunks are held at once.
+    // With a symbol list, workers decode with a lookahead copy of the filter and stock locates
+    // are resolved as the records are handed over in feed order, where the records of stocks
+    // that are not selected are replaced by bucket ticks.
+    class ParallelFrameDecoder {
+    public:
+        ParallelFrameDecoder(size_t threads, const MessageFilter& filter = MessageFilter::all(),
+            uint64_t bucket_width = kNanosPerHour, size_t chunk_size = 4u << 20)
+            : threads_(std::max<size_t>(threads, 1)), chunk_size_(std::max<size_t>(chunk_size, 4096)), filter_(filter),
+            lookahead_(filter.lookahead()), bucket_width_(bucket_width) {}
+
+        // on_chunk(bytes_done) is called after each chunk has been passed to the sink
+        template<typename Sink, typename Progress>
+        void run(const std::byte* data, size_t size, Sink&& sink, Progress&& on_chunk) {
+            std::vector<size_t> bounds{ 0 };
+            for (size_t offset = chunk_size_; offset < size; offset += chunk_size_) {
+                size_t boundary = findFrameBoundary(data, size, std::max(offset, bounds.back()));
+                if (boundary > bounds.back() && boundary < size) bounds.push_back(boundary);
+            }
+            bounds.push_back(size);
+            const size_t chunks = bounds.size() - 1;
+            const size_t window = 2 * threads_;
+
+            std::vector<std::vector<ItchMessageRecord>> slots(window);
+            std::vector<size_t> ready(window, SIZE_MAX);  // chunk index held by each slot
+            std::mutex mutex;
+            std::condition_variable slot_ready;
+            std::condition_variable slot_free;
+            std::atomic<size_t> next_chunk{ 0 };
+            size_t consumed = 0;
+
+            auto worker = [&]() {
+                std::vector<ItchMessageRecord> records;
+                while (true) {
+                    size_t chunk = next_chunk.fetch_add(1);
+                    if (chunk >= chunks) return;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        slot_free.wait(lock, [&] { return chunk < consumed + window; });
+                        records.swap(slots[chunk % window]);
+                    }
+                    records.clear();
+                    parseFrames(data + bounds[chunk], data + bounds[chunk + 1],
+                        [&](ItchMessageRecord&& record) { records.push_back(std::move(record)); }, lookahead_, bucket_width_);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        records.swap(slots[chunk % window]);
+                        ready[chunk % window] = chunk;
+                    }
+                    slot_ready.notify_all();
+                }
+            };
+
+            uint64_t next_bucket_time = 0u;  // as in parseFrames, for the records replaced by ticks
+            auto forward = [&](ItchMessageRecord&& record)
+                {
+                    const ItchMessage& header = messageHeader(record);
+                    bool selected = header.message_type == kBucketTick
+                        || (header.message_type == 'R' ? filter_.resolve(std::get<StockDirectoryMessage>(record))
+                            : filter_.symbols()->selected(header.stock_id));
+                    uint64_t message_time = header.message_time;
+                    if (message_time >= next_bucket_time) {
+                        next_bucket_time = (message_time / bucket_width_ + 1) * bucket_width_;
+                        if (!selected) {
+                            ItchMessage tick(kBucketTick);
+                            tick.message_time = message_time;
+                            sink(ItchMessageRecord(tick));
+                        }
+                    }
+                    if (selected) sink(std::move(record));
+                };
+
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < threads_; ++i) {
+                workers.emplace_back(worker);
+            }
+            for (size_t chunk = 0; chunk < chunks; ++chunk) {
+                std::vector<ItchMessageRecord>* records;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    slot_ready.wait(lock, [&] { return ready[chunk % window] == chunk; });
+                    records = &slots[chunk % window];
+                }
+                for (ItchMessageRecord& record : *records) {
+                    if (filter_.symbols()) forward(std::move(record));
+                    else sink(std::move(record));
+                }
+                on_chunk(bounds[chunk + 1]);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ++consumed;
+                }
+                slot_free.notify_all();
+            }
+            for (auto& thread : workers) {
+                thread.join();
+            }
+        }
+
+    private:
+        size_t threads_;
+        size_t chunk_size_;
+        MessageFilter filter_;
+        MessageFilter lookahead_;
+        uint64_t bucket_width_;
+    };
+}
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 18:20:47
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 18:20:47
+ */
+
+#ifndef GZIP_READER_H
+#define GZIP_READER_H
+
+#include <zlib.h>
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <condition_variable>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+#include "MemoryMappedFileReader.h"
+
+namespace GuG {
+
+    // Reads a gzip compressed feed without writing the decompressed data anywhere: members are
+    // inflated on background threads straight into a window of large blocks, and the consumer
+    // parses the blocks in place, in order.
+    // BGZF files (bgzip) record the compressed size of every member, so their members are inflated
+    // on several threads; any other gzip file is inflated by one thread, member after member.
+    class GzipReader {
+    public:
+        // A frame cut at the end of a block is carried into the space reserved before the next one
+        static constexpr size_t kCarrySize = 2 + 65535;
+        static constexpr size_t kBlockSize = 16u << 20;      // one thread inflating
+        static constexpr size_t kChunkSize = 4u << 20;       // per BGZF worker, 2 per thread in flight
+
+        GzipReader(const char* filepath, size_t threads)
+            : file_(filepath), threads_(std::max<size_t>(threads, 1)) {
+            data_ = reinterpret_cast<const unsigned char*>(file_.data());
+            size_ = file_.size();
+            if (size_ < 2 || data_[0] != 0x1f || data_[1] != 0x8b) {
+                throw std::runtime_error("Not a gzip file");
+            }
+            findBgzfMembers();
+        }
+
+        bool parallel() const { return !chunks_.empty(); }
+        size_t compressedSize() const { return size_; }
+
+        // Calls consume(begin, end) for every decompressed block in order. consume returns the
+        // start of the bytes it did not use (an incomplete frame), which are passed again in front
+        // of the next block. Throws std::runtime_error on corrupt input.
+        template<typename Consume>
+        void run(Consume&& consume) {
+            const size_t window = parallel() ? 2 * threads_ : 3;
+            blocks_.assign(window, Block{});
+            for (Block& block : blocks_) {
+                block.storage.resize(kCarrySize + (parallel() ? max_chunk_size_ : kBlockSize));
+            }
+            consumed_ = 0;
+            produced_ = SIZE_MAX;
+            error_.clear();
+
+            std::vector<std::thread> workers;
+            if (parallel()) {
+                next_chunk_ = 0;
+                produced_ = chunks_.size();
+                for (size_t i = 0; i < threads_; ++i) {
+                    workers.emplace_back([this] { guarded([this] { inflateChunks(); }); });
+                }
+            }
+            else {
+                workers.emplace_back([this] { guarded([this] { inflateSequential(); }); });
+            }
+
+            std::vector<std::byte> carry;
+            try {
+                for (size_t block_index = 0;; ++block_index) {
+                    Block* block;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        block_ready_.wait(lock, [&] {
+                            return !error_.empty() || block_index >= produced_ || blocks_[block_index % window].index == block_index;
+                            });
+                        if (!error_.empty()) break;
+                        if (block_index >= produced_) break;
+                        block = &blocks_[block_index % window];
+                    }
+                    std::byte* payload = block->storage.data() + kCarrySize;
+                    std::byte* begin = payload - carry.size();
+                    std::memcpy(begin, carry.data(), carry.size());
+                    const std::byte* end = payload + block->size;
+                    const std::byte* rest = consume(static_cast<const std::byte*>(begin), end);
+                    if (static_cast<size_t>(end - rest) > kCarrySize) {
+                        throw std::runtime_error("Unparsable data in gzip input");
+                    }
+                    carry.assign(rest, end);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        block->index = SIZE_MAX;
+                        ++consumed_;
+                    }
+                    block_free_.notify_all();
+                }
+            }
+            catch (...) {
+                fail("stopped");
+                for (auto& worker : workers) worker.join();
+                throw;
+            }
+            for (auto& worker : workers) worker.join();
+            if (!error_.empty()) {
+                throw std::runtime_error("Error decompressing gzip input: " + error_);
+            }
+        }
+
+    private:
+        struct Block {
+            std::vector<std::byte> storage;  // kCarrySize reserved bytes, then the inflated data
+            size_t size = 0;
+            size_t index = SIZE_MAX;         // block of the feed held, SIZE_MAX when free
+        };
+
+        // A run of consecutive BGZF members inflated into one block
+        struct Chunk {
+            size_t offset;
+            size_t compressed_size;
+            size_t size;
+        };
+
+        // BGZF members are gzip members with a BC extra field holding the member size - 1.
+        // Leaves chunks_ empty if any member lacks it.
+        void findBgzfMembers() {
+            size_t offset = 0;
+            std::vector<Chunk> chunks;
+            Chunk chunk{ 0, 0, 0 };
+            while (offset < size_) {
+                const unsigned char* member = data_ + offset;
+                if (size_ - offset < 18 || member[0] != 0x1f || member[1] != 0x8b || member[2] != 8 || !(member[3] & 4)) return;
+                size_t extra_size = member[10] | (member[11] << 8);
+                size_t member_size = 0;
+                for (size_t field = 12; field + 4 <= 12 + extra_size && field + 4 <= size_ - offset;) {
+                    size_t field_size = member[field + 2] | (member[field + 3] << 8);
+                    if (member[field] == 'B' && member[field + 1] == 'C' && field_size == 2 && field + 6 <= size_ - offset) {
+                        member_size = (member[field + 4] | (member[field + 5] << 8)) + 1;
+                    }
+                    field += 4 + field_size;
+                }
+                if (member_size < 18 || member_size > size_ - offset) return;
+                const unsigned char* trailer = member + member_size - 4;
+                size_t inflated = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<size_t>(trailer[3]) << 24);
+                if (chunk.size + inflated > kChunkSize && chunk.compressed_size != 0) {
+                    chunks.push_back(chunk);
+                    chunk = Chunk{ offset, 0, 0 };
+                }
+                chunk.compressed_size += member_size;
+                chunk.size += inflated;
+                offset += member_size;
+            }
+            if (chunk.compressed_size != 0) chunks.push_back(chunk);
+            if (chunks.size() < 2) return;  // nothing to gain from threads
+            max_chunk_size_ = 0;
+            for (const Chunk& c : chunks) max_chunk_size_ = std::max(max_chunk_size_, c.size);
+            chunks_ = std::move(chunks);
+        }
+
+        // Waits for the window slot of block_index; nullptr if the run is being abandoned
+        Block* acquire(size_t block_index) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            block_free_.wait(lock, [&] { return !error_.empty() || block_index < consumed_ + blocks_.size(); });
+            return error_.empty() ? &blocks_[block_index % blocks_.size()] : nullptr;
+        }
+
+        void publish(Block* block, size_t block_index, size_t size) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                block->size = size;
+                block->index = block_index;
+            }
+            block_ready_.notify_all();
+        }
+
+        void fail(const std::string& error) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (error_.empty()) error_ = error;
+            }
+            block_ready_.notify_all();
+            block_free_.notify_all();
+        }
+
+        template<typename Fn>
+        void guarded(Fn&& fn) {
+            try {
+                fn();
+            }
+            catch (const std::exception& e) {
+                fail(e.what());
+            }
+        }
+
+        // zlib counts input and output in uInt
+        static constexpr size_t kMaxInflateStep = 1u << 30;
+
+        // One thread inflating the whole file; concatenated members are inflated one after another
+        void inflateSequential() {
+            z_stream stream{};
+            if (inflateInit2(&stream, 15 + 16) != Z_OK) throw std::runtime_error("inflateInit2 failed");
+            size_t input_offset = 0;
+            bool done = false;
+            size_t block_index = 0;
+            try {
+                while (!done) {
+                    Block* block = acquire(block_index);
+                    if (block == nullptr) break;
+                    std::byte* out = block->storage.data() + kCarrySize;
+                    size_t filled = 0;
+                    while (filled < kBlockSize && !done) {
+                        if (stream.avail_in == 0) {
+                            size_t step = std::min(size_ - input_offset, kMaxInflateStep);
+                            stream.next_in = const_cast<Bytef*>(data_ + input_offset);
+                            stream.avail_in = static_cast<uInt>(step);
+                            input_offset += step;
+                        }
+                        stream.next_out = reinterpret_cast<Bytef*>(out + filled);
+                        stream.avail_out = static_cast<uInt>(kBlockSize - filled);
+                        int result = inflate(&stream, Z_NO_FLUSH);
+                        filled = kBlockSize - stream.avail_out;
+                        if (result == Z_STREAM_END) {
+                            // another member may follow; anything else after the last one is ignored
+                            size_t next = input_offset - stream.avail_in;
+                            if (size_ - next < 2 || data_[next] != 0x1f || data_[next + 1] != 0x8b) {
+                                done = true;
+                            }
+                            else {
+                                inflateReset(&stream);
+                            }
+                        }
+                        else if (result == Z_BUF_ERROR && stream.avail_in == 0 && input_offset == size_) {
+                            throw std::runtime_error("truncated input");
+                        }
+                        else if (result != Z_OK && result != Z_BUF_ERROR) {
+                            throw std::runtime_error(stream.msg != nullptr ? stream.msg : "corrupt input");
+                        }
+                    }
+                    publish(block, block_index++, filled);
+                }
+            }
+            catch (...) {
+                inflateEnd(&stream);
+                throw;
+            }
+            inflateEnd(&stream);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                produced_ = block_index;
+            }
+            block_ready_.notify_all();
+        }
+
+        // Worker thread of a BGZF file: takes the next chunk, inflates its members into its block
+        void inflateChunks() {
+            z_stream stream{};
+            if (inflateInit2(&stream, 15 + 16) != Z_OK) throw std::runtime_error("inflateInit2 failed");
+            while (true) {
+                size_t chunk_index = next_chunk_.fetch_add(1);
+                if (chunk_index >= chunks_.size()) break;
+                Block* block = acquire(chunk_index);
+                if (block == nullptr) break;
+                const Chunk& chunk = chunks_[chunk_index];
+                inflateReset(&stream);
+                stream.next_in = const_cast<Bytef*>(data_ + chunk.offset);
+                stream.avail_in = static_cast<uInt>(chunk.compressed_size);
+                stream.next_out = reinterpret_cast<Bytef*>(block->storage.data() + kCarrySize);
+                stream.avail_out = static_cast<uInt>(chunk.size);
+                int result = Z_OK;
+                while (stream.avail_in != 0) {
+                    result = inflate(&stream, Z_FINISH);
+                    if (result != Z_STREAM_END) break;
+                    inflateReset(&stream);
+                }
+                if (stream.avail_in != 0 || stream.avail_out != 0) {
+                    inflateEnd(&stream);
+                    throw std::runtime_error(stream.msg != nullptr ? stream.msg : "corrupt BGZF member");
+                }
+                publish(block, chunk_index, chunk.size);
+            }
+            inflateEnd(&stream);
+        }
+
+        MemoryMappedFileReader file_;
+        const unsigned char* data_ = nullptr;
+        size_t size_ = 0;
+        const size_t threads_;
+        std::vector<Chunk> chunks_;
+        size_t max_chunk_size_ = 0;
+
+        std::vector<Block> blocks_;
+        std::mutex mutex_;
+        std::condition_variable block_ready_;
+        std::condition_variable block_free_;
+        std::atomic<size_t> next_chunk_{ 0 };
+        size_t consumed_ = 0;
+        size_t produced_ = SIZE_MAX;  // number of blocks once known
+        std::string error_;
+    };
+}
+
+#endif
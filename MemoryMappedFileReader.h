@@ -12,6 +12,8 @@
 #include <sys/stat.h> // For stat
 #include <fcntl.h>    // For file constants
 #include <unistd.h>   // For close
+#include <algorithm>
+#include <iostream>
 #include <stdexcept>
 
 namespace GuG {
@@ -63,9 +65,38 @@ namespace GuG {
         void* data() const { return mapped; }
         size_t size() const { return fileSize; }
 
+        // Hints for one pass from the start: aggressive kernel read-ahead, and huge pages where
+        // the kernel supports them for file mappings (ignored elsewhere)
+        void adviseSequential() {
+            madvise(mapped, fileSize, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+            madvise(mapped, fileSize, MADV_HUGEPAGE);
+#endif
+        }
+
+        // Starts reading [offset, offset + length) in the background
+        void prefetch(size_t offset, size_t length) {
+            offset = offset / pageSize * pageSize;
+            if (offset >= fileSize) return;
+            length = std::min(length, fileSize - offset);
+            madvise(static_cast<char*>(mapped) + offset, length, MADV_WILLNEED);
+        }
+
+        // Drops the pages before offset from the process. The page cache keeps them, and the
+        // private mapping is never written, so touching them again only faults them back in.
+        void release(size_t offset) {
+            offset = std::min(offset, fileSize) / pageSize * pageSize;
+            if (offset <= released) return;
+            madvise(static_cast<char*>(mapped) + released, offset - released, MADV_DONTNEED);
+            released = offset;
+        }
+
     private:
+
         void* mapped = nullptr;
         size_t fileSize = 0;
+        size_t released = 0;    // pages before this offset were released
+        const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
         int fd = -1;
     };
 }
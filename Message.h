@@ -9,21 +9,31 @@
 #ifndef MESSAGE_H
 #define MESSAGE_H
 
-#include <unordered_map>
-#include <memory>
+#include <array>
+#include <variant>
 
 #include "Utility.h"
+#include "SimdDecode.h"
 
 namespace GuG {
 
+    // Message timestamps are nanoseconds since midnight
+    constexpr uint64_t kNanosPerHour = 3600000000000ULL;
+
+    // Control records the reader puts in the processor queues as bare ItchMessages.
+    // None of these values is an ITCH message type.
+    constexpr char kBucketTick = '\0';     // a VWAP bucket may start at message_time
+    constexpr char kPublishTick = '\x01';  // publish the open bucket (streaming input)
+    constexpr char kLatencyProbe = '\x02'; // message_time is the reader's cycle count (metrics builds)
+    constexpr char kCheckpointTick = '\x03'; // copy the shard state for checkpoint stock_id (Checkpoint.h)
+
     class ItchMessage {
     public:
-        ItchMessage(char message_type) : message_type(message_type) {}
-        virtual ~ItchMessage() = default; // Ensure proper cleanup of derived classes
-        void initalize(const std::byte*& data) {
-            stock_id = read<uint16_t>(data);
+        ItchMessage(char message_type = '\0') : message_type(message_type) {}
+        void initalize(const std::byte*& data, bool bigEndian = true) {
+            stock_id = read<uint16_t>(data, bigEndian);
             skipByOffset(data, 2);
-            message_time = readTimeStamp(data);
+            message_time = readTimeStamp(data, bigEndian);
         }
 
         char message_type;
@@ -31,17 +41,20 @@ namespace GuG {
         uint64_t message_time = 0u;
 
         inline uint8_t getMsgHour() const {
-            return message_time / 3600000000000LL;
+            return message_time / kNanosPerHour;
         }
     };
 
     // R
     class StockDirectoryMessage : public ItchMessage {
     public:
-        std::string stock_symbol;
-        StockDirectoryMessage(const std::byte*& data) : ItchMessage('R') {
-            initalize(data);
-            stock_symbol = readStock(data);
+        StockSymbol stock_symbol;
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 } };
+
+        StockDirectoryMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('R') {
+            initalize(data, bigEndian);
+            stock_symbol = readStockSymbol(data);
             skipByOffset(data, 20);
         }
     };
@@ -52,13 +65,17 @@ namespace GuG {
         uint64_t order_id;          // Order Reference Number
         uint32_t shares;            // Shares
         uint32_t price;             // Price
-        AddOrderMessage(const std::byte*& data) : ItchMessage('A') {
-            initalize(data);
-            order_id = read<uint64_t>(data);
-            skipByOffset(data, 1);
-            shares = read<uint32_t>(data);
+        char side;                  // Buy/Sell Indicator, 'B' or 'S'
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 }, { 10, 8 }, { 19, 4 }, { 31, 4 } };
+
+        AddOrderMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('A') {
+            initalize(data, bigEndian);
+            order_id = read<uint64_t>(data, bigEndian);
+            side = read<char>(data);
+            shares = read<uint32_t>(data, bigEndian);
             skipByOffset(data, 8);
-            price = read<uint32_t>(data);
+            price = read<uint32_t>(data, bigEndian);
         }
 
     };
@@ -69,14 +86,18 @@ namespace GuG {
         uint64_t order_id;              // Order Reference Number
         uint64_t shares;                // Shares
         uint32_t price;                 // Price
+        char side;                      // Buy/Sell Indicator, 'B' or 'S'
 
-        AddOrderMPIDAttributionMessage(const std::byte*& data) : ItchMessage('F') {
-            initalize(data);
-            order_id = read<uint64_t>(data);
-            skipByOffset(data, 1);
-            shares = read<uint32_t>(data);
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 }, { 10, 8 }, { 19, 4 }, { 31, 4 } };
+
+        AddOrderMPIDAttributionMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('F') {
+            initalize(data, bigEndian);
+            order_id = read<uint64_t>(data, bigEndian);
+            side = read<char>(data);
+            shares = read<uint32_t>(data, bigEndian);
             skipByOffset(data, 8);
-            price = read<uint32_t>(data);
+            price = read<uint32_t>(data, bigEndian);
             skipByOffset(data, 4);
         }
 
@@ -89,11 +110,14 @@ namespace GuG {
         uint32_t executed_shares;  // Executed Shares
         uint64_t match_number;          // Match Number
 
-        OrderExecutedMessage(const std::byte*& data) : ItchMessage('E') {
-            initalize(data);
-            order_id = read<uint64_t>(data);
-            executed_shares = read<uint32_t>(data);
-            match_number = read<uint64_t>(data);
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 }, { 10, 8 }, { 18, 4 }, { 22, 8 } };
+
+        OrderExecutedMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('E') {
+            initalize(data, bigEndian);
+            order_id = read<uint64_t>(data, bigEndian);
+            executed_shares = read<uint32_t>(data, bigEndian);
+            match_number = read<uint64_t>(data, bigEndian);
         }
     };
 
@@ -107,13 +131,48 @@ namespace GuG {
         uint32_t execution_price;       // Execution Price
         uint64_t match_number;          // Match Number
 
-        OrderExecutedWithPriceMessage(const std::byte*& data) : ItchMessage('C') {
-            initalize(data);
-            order_id = read<uint64_t>(data);
-            executed_shares = read<uint32_t>(data);
-            match_number = read<uint64_t>(data);
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 }, { 10, 8 }, { 18, 4 }, { 22, 8 }, { 31, 4 } };
+
+        OrderExecutedWithPriceMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('C') {
+            initalize(data, bigEndian);
+            order_id = read<uint64_t>(data, bigEndian);
+            executed_shares = read<uint32_t>(data, bigEndian);
+            match_number = read<uint64_t>(data, bigEndian);
             printable = read<char>(data);
-            execution_price = read<uint32_t>(data);
+            execution_price = read<uint32_t>(data, bigEndian);
+        }
+    };
+
+
+    // X
+    class OrderCancelMessage : public ItchMessage {
+    public:
+        uint64_t order_id;              // Order Reference Number
+        uint32_t cancelled_shares;      // Cancelled Shares
+
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 }, { 10, 8 }, { 18, 4 } };
+
+        OrderCancelMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('X') {
+            initalize(data, bigEndian);
+            order_id = read<uint64_t>(data, bigEndian);
+            cancelled_shares = read<uint32_t>(data, bigEndian);
+        }
+    };
+
+
+    // D
+    class OrderDeleteMessage : public ItchMessage {
+    public:
+        uint64_t order_id;              // Order Reference Number
+
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 }, { 10, 8 } };
+
+        OrderDeleteMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('D') {
+            initalize(data, bigEndian);
+            order_id = read<uint64_t>(data, bigEndian);
         }
     };
 
@@ -126,12 +185,15 @@ namespace GuG {
         uint32_t shares;             // Shares
         uint32_t price;              // Price
 
-        OrderReplaceMessage(const std::byte*& data) : ItchMessage('U') {
-            initalize(data);
-            original_order_id = read<uint64_t>(data);
-            new_order_id = read<uint64_t>(data);
-            shares = read<uint32_t>(data);
-            price = read<uint32_t>(data);
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 }, { 10, 8 }, { 18, 8 }, { 26, 4 }, { 30, 4 } };
+
+        OrderReplaceMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('U') {
+            initalize(data, bigEndian);
+            original_order_id = read<uint64_t>(data, bigEndian);
+            new_order_id = read<uint64_t>(data, bigEndian);
+            shares = read<uint32_t>(data, bigEndian);
+            price = read<uint32_t>(data, bigEndian);
         }
     };
 
@@ -145,14 +207,17 @@ namespace GuG {
         uint32_t price;                 // Price
         uint64_t match_number;          // Match Number
 
-        NonCrossTradeMessage(const std::byte*& data) : ItchMessage('P') {
-            initalize(data);
-            order_id = read<uint64_t>(data);
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 }, { 10, 8 }, { 19, 4 }, { 31, 4 }, { 35, 8 } };
+
+        NonCrossTradeMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('P') {
+            initalize(data, bigEndian);
+            order_id = read<uint64_t>(data, bigEndian);
             skipByOffset(data, 1);
-            shares = read<uint32_t>(data);
+            shares = read<uint32_t>(data, bigEndian);
             skipByOffset(data, 8);
-            price = read<uint32_t>(data);
-            match_number = read<uint64_t>(data);
+            price = read<uint32_t>(data, bigEndian);
+            match_number = read<uint64_t>(data, bigEndian);
         }
     };
 
@@ -164,13 +229,16 @@ namespace GuG {
         uint32_t cross_price;           // Price
         uint64_t match_number;          // Match Number
 
-        CrossTradeMessage(const std::byte*& data) : ItchMessage('Q') {
-            initalize(data);
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 }, { 10, 8 }, { 26, 4 }, { 30, 8 } };
 
-            shares = read<uint64_t>(data);
+        CrossTradeMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('Q') {
+            initalize(data, bigEndian);
+
+            shares = read<uint64_t>(data, bigEndian);
             skipByOffset(data, 8);
-            cross_price = read<uint32_t>(data);
-            match_number = read<uint64_t>(data);
+            cross_price = read<uint32_t>(data, bigEndian);
+            match_number = read<uint64_t>(data, bigEndian);
             skipByOffset(data, 1);
         }
     };
@@ -180,110 +248,221 @@ namespace GuG {
     class BrokenTradeMessage : public ItchMessage {
     public:
         uint64_t match_number;          // Match Number
-        BrokenTradeMessage(const std::byte*& data) : ItchMessage('B') {
-            initalize(data);
-            match_number = read<uint64_t>(data);
+        // big-endian fields as (offset after the type byte, width)
+        static constexpr FieldSpan kSwappedFields[] = { { 0, 2 }, { 2, 2 }, { 4, 6 }, { 10, 8 } };
+
+        BrokenTradeMessage(const std::byte*& data, bool bigEndian = true) : ItchMessage('B') {
+            initalize(data, bigEndian);
+            match_number = read<uint64_t>(data, bigEndian);
         }
     };
 
 
-    // Factory class to create instances of message types
-    class MessageFactory {
-    public:
-        using MessageCreator = std::unique_ptr<ItchMessage>(*)(const std::byte*&);
+    // Fixed-size, by-value record holding any of the decoded messages above.
+    // A default constructed record holds a bare ItchMessage with message_type '\0'.
+    using ItchMessageRecord = std::variant<ItchMessage,
+        StockDirectoryMessage,
+        AddOrderMessage,
+        AddOrderMPIDAttributionMessage,
+        OrderExecutedMessage,
+        OrderExecutedWithPriceMessage,
+        OrderCancelMessage,
+        OrderDeleteMessage,
+        OrderReplaceMessage,
+        NonCrossTradeMessage,
+        CrossTradeMessage,
+        BrokenTradeMessage>;
+
+    // Common header (type, stock id, timestamp) of whichever message the record holds
+    inline const ItchMessage& messageHeader(const ItchMessageRecord& record) {
+        return std::visit([](const ItchMessage& message) -> const ItchMessage& { return message; }, record);
+    }
+
+    using MessageDecoder = void(*)(const std::byte*&, ItchMessageRecord&);
+
+    template<typename Message>
+    void decodeMessage(const std::byte*& data, ItchMessageRecord& record) {
+        record.emplace<Message>(data);
+    }
 
+    // Size of the message after its type byte, and the decoder for the types we process
+    struct MessageTypeInfo {
+        uint8_t size = 0;                   // 0: unknown type
+        MessageDecoder decode = nullptr;    // nullptr: known size, not decoded
+    };
+
+    using MessageTable = std::array<MessageTypeInfo, 256>;
+
+    // Built at compile time and indexed by the type byte, so finding a message's size and
+    // decoder is a single array load
+    constexpr MessageTable makeMessageTable() {
+        MessageTable table{};
+        auto add = [&table](char messageType, uint8_t size, MessageDecoder decode = nullptr) {
+            table[static_cast<unsigned char>(messageType)] = { size, decode };
+        };
+        /*--------------------------------------- VWAP related--------------------------------------*/
+        add('R', 38, &decodeMessage<StockDirectoryMessage>);            // Stock Directory
+        add('A', 35, &decodeMessage<AddOrderMessage>);                  // Added orders
+        add('F', 39, &decodeMessage<AddOrderMPIDAttributionMessage>);   // Added orders
+        add('E', 30, &decodeMessage<OrderExecutedMessage>);             // Executed orders
+        add('C', 35, &decodeMessage<OrderExecutedWithPriceMessage>);    // Executed orders
+        add('U', 34, &decodeMessage<OrderReplaceMessage>);              // Modifications
+        add('P', 43, &decodeMessage<NonCrossTradeMessage>);             // Undisplayable non-cross orders executed
+        add('Q', 39, &decodeMessage<CrossTradeMessage>);                // Cross Trade Message
+        add('B', 18, &decodeMessage<BrokenTradeMessage>);               // Broken Trade / Order ExecutionMessage
+        add('X', 22, &decodeMessage<OrderCancelMessage>);               // Order Cancel Message: shrinks live orders
+        add('D', 18, &decodeMessage<OrderDeleteMessage>);               // Order Delete Message: removes live orders
+        /*-------------------------------------Not VWAP related------------------------------------*/
+        add('S', 11);   // System Event Message
+        add('H', 24);   // Stock Trading Action
+        add('Y', 19);   // Reg SHO Short Sale Price Test RestrictedIndicator
+        add('L', 25);   // Market Participant Position
+        add('V', 34);   // MWCB Decline Level Message
+        add('W', 11);   // MWCB Status Message
+        add('K', 27);   // Quoting Period Update
+        add('J', 34);   // Limit Up – Limit Down (LULD) Auction Collar
+        add('h', 20);   // Operational Halt
+        add('I', 49);   // Net Order Imbalance Indicator (NOII)Message
+        add('N', 19);   // Retail Price Improvement Indicator(RPII)
+        add('O', 47);   // Direct Listing with Capital Raise Price Discovery Message
+        return table;
+    }
 
-        static void registerMessageCreator(char messageType, MessageCreator creator) {
-            messageCreators_[messageType] = std::move(creator);
+    inline constexpr MessageTable kMessageTable = makeMessageTable();
+
+    // Total message lengths (type byte included) from the ITCH 5.0 specification
+    constexpr bool hasSpecLength(char messageType, size_t length) {
+        return kMessageTable[static_cast<unsigned char>(messageType)].size + 1u == length;
+    }
+    static_assert(hasSpecLength('S', 12) && hasSpecLength('R', 39) && hasSpecLength('H', 25) && hasSpecLength('Y', 20));
+    static_assert(hasSpecLength('L', 26) && hasSpecLength('V', 35) && hasSpecLength('W', 12) && hasSpecLength('K', 28));
+    static_assert(hasSpecLength('J', 35) && hasSpecLength('h', 21) && hasSpecLength('A', 36) && hasSpecLength('F', 40));
+    static_assert(hasSpecLength('E', 31) && hasSpecLength('C', 36) && hasSpecLength('X', 23) && hasSpecLength('D', 19));
+    static_assert(hasSpecLength('U', 35) && hasSpecLength('P', 44) && hasSpecLength('Q', 40) && hasSpecLength('B', 19));
+    static_assert(hasSpecLength('I', 50) && hasSpecLength('N', 20) && hasSpecLength('O', 48));
+
+#ifdef GUG_X86_SIMD
+    // Vectorised decoders: byte swap the whole Size byte body in one SIMD pass into an aligned
+    // staging buffer and build the message from the native-endian copy. Messages too close to
+    // the end of a page for a full-width load take the scalar decoder instead.
+    template<typename Message, size_t Size>
+    void decodeMessageFromNative(const std::byte* staging, const std::byte*& data, ItchMessageRecord& record) {
+        const std::byte* native = staging;
+        record.emplace<Message>(native, false);
+        data += Size;
+    }
+
+    template<typename Message, size_t Size>
+    __attribute__((target("ssse3")))
+    void decodeMessageSsse3(const std::byte*& data, ItchMessageRecord& record) {
+        static_assert(Size <= kMaxSwappedBody, "message body does not fit the swap kernels");
+        static constexpr ByteSwapMasks masks = makeByteSwapMasks(Message::kSwappedFields);
+        if (!canOverreadStaging(data)) {
+            decodeMessage<Message>(data, record);
+            return;
         }
+        alignas(32) std::byte staging[kSwapStagingSize];
+        swapFieldsSsse3(data, staging, masks);
+        decodeMessageFromNative<Message, Size>(staging, data, record);
+    }
 
+    template<typename Message, size_t Size>
+    __attribute__((target("avx2")))
+    void decodeMessageAvx2(const std::byte*& data, ItchMessageRecord& record) {
+        static_assert(Size <= kMaxSwappedBody, "message body does not fit the swap kernels");
+        static constexpr ByteSwapMasks masks = makeByteSwapMasks(Message::kSwappedFields);
+        if (!canOverreadStaging(data)) {
+            decodeMessage<Message>(data, record);
+            return;
+        }
+        alignas(32) std::byte staging[kSwapStagingSize];
+        swapFieldsAvx2(data, staging, masks);
+        decodeMessageFromNative<Message, Size>(staging, data, record);
+    }
+#endif
 
-        static std::unique_ptr<ItchMessage> createMessage(char messageType, const std::byte*& data) {
-            auto it = messageCreators_.find(messageType);
-            if (it != messageCreators_.end()) {
-                return (it->second)(data);
-            }
-            return nullptr;
+    using MessageDecoderTable = std::array<MessageDecoder, 256>;
+
+#ifdef GUG_X86_SIMD
+    template<char MessageType, typename Message, SimdLevel Level>
+    void setSwappedDecoder(MessageDecoderTable& decoders) {
+        constexpr size_t size = kMessageTable[static_cast<unsigned char>(MessageType)].size;
+        if constexpr (Level == SimdLevel::Avx2) {
+            decoders[static_cast<unsigned char>(MessageType)] = &decodeMessageAvx2<Message, size>;
         }
+        else {
+            decoders[static_cast<unsigned char>(MessageType)] = &decodeMessageSsse3<Message, size>;
+        }
+    }
 
+    template<SimdLevel Level>
+    void setSwappedDecoders(MessageDecoderTable& decoders) {
+        setSwappedDecoder<'R', StockDirectoryMessage, Level>(decoders);
+        setSwappedDecoder<'A', AddOrderMessage, Level>(decoders);
+        setSwappedDecoder<'F', AddOrderMPIDAttributionMessage, Level>(decoders);
+        setSwappedDecoder<'E', OrderExecutedMessage, Level>(decoders);
+        setSwappedDecoder<'C', OrderExecutedWithPriceMessage, Level>(decoders);
+        setSwappedDecoder<'U', OrderReplaceMessage, Level>(decoders);
+        setSwappedDecoder<'P', NonCrossTradeMessage, Level>(decoders);
+        setSwappedDecoder<'Q', CrossTradeMessage, Level>(decoders);
+        setSwappedDecoder<'B', BrokenTradeMessage, Level>(decoders);
+        setSwappedDecoder<'X', OrderCancelMessage, Level>(decoders);
+        setSwappedDecoder<'D', OrderDeleteMessage, Level>(decoders);
+    }
+#endif
 
-    private:
-        static std::unordered_map<char, MessageCreator> messageCreators_;
-        static std::unordered_map<char, int> messageSizes_;
+    // Decoders for the given instruction set; the scalar level keeps the field by field decoders
+    inline MessageDecoderTable makeMessageDecoders(SimdLevel level) {
+        MessageDecoderTable decoders{};
+        for (size_t i = 0; i < decoders.size(); ++i) {
+            decoders[i] = kMessageTable[i].decode;
+        }
+#ifdef GUG_X86_SIMD
+        if (level == SimdLevel::Avx2) setSwappedDecoders<SimdLevel::Avx2>(decoders);
+        else if (level == SimdLevel::Ssse3) setSwappedDecoders<SimdLevel::Ssse3>(decoders);
+#endif
+        return decoders;
+    }
 
+    // Decodes message types into records. Sizes come from kMessageTable; the decoders default to
+    // the scalar field readers and can be switched to the vector ones at startup
+    class MessageFactory {
     public:
-        static void populateMessageSizeMap() {
-            /*--------------------------------------- VWAP related--------------------------------------*/
-            messageSizes_['R'] = 38;    // Stock Directory
-            messageSizes_['A'] = 35;    // Added orders
-            messageSizes_['F'] = 39;    // Added orders
-            messageSizes_['E'] = 30;    // Executed orders
-            messageSizes_['C'] = 35;    // Executed orders
-            messageSizes_['U'] = 34;    // Modifications
-            messageSizes_['P'] = 43;    // Undisplayable non-cross orders executed
-            messageSizes_['Q'] = 39;    // Cross Trade Message
-            messageSizes_['B'] = 18;    // Broken Trade / Order ExecutionMessage
-            /*-------------------------------------Not VWAP related------------------------------------*/
-            messageSizes_['S'] = 11;    // System Event Message
-            messageSizes_['H'] = 24;    // Stock Trading Action
-            messageSizes_['Y'] = 19;    // Reg SHO Short Sale Price Test RestrictedIndicator
-            messageSizes_['L'] = 25;    // Market Participant Position
-            messageSizes_['V'] = 34;    // MWCB Decline Level Message
-            messageSizes_['W'] = 11;    // MWCB Status Message
-            messageSizes_['K'] = 27;    // Quoting Period Update
-            messageSizes_['J'] = 34;    // Limit Up – Limit Down (LULD) Auction Collar
-            messageSizes_['h'] = 20;    // Operational Halt
-            messageSizes_['X'] = 22;    // Order Cancel Message
-            messageSizes_['D'] = 18;    // Order Delete Message: Not processed but could create memory issue
-            messageSizes_['I'] = 49;    //  Net Order Imbalance Indicator (NOII)Message
-            messageSizes_['N'] = 19;    // Retail Price Improvement Indicator(RPII)
-            messageSizes_['O'] = 47;    //Direct Listing with Capital Raise Price Discovery Message
+        // Decodes the message in place into record, returns false if the type is not decoded
+        static bool createMessage(char messageType, const std::byte*& data, ItchMessageRecord& record) {
+            MessageDecoder decode = decoders_[static_cast<unsigned char>(messageType)];
+            if (decode == nullptr) {
+                return false;
+            }
+            decode(data, record);
+            return true;
         }
 
-        static size_t getMessageSize(const char& messageType) {
-            auto it = messageSizes_.find(messageType);
-            if (it == MessageFactory::messageSizes_.end()) {
-                return 0;
-            }
-            else {
-                return it->second;
-            }
+        // Not thread safe: call before any reader thread starts
+        static void useSimdLevel(SimdLevel level) {
+#ifndef GUG_X86_SIMD
+            level = SimdLevel::Scalar;
+#endif
+            simd_level_ = level;
+            decoders_ = makeMessageDecoders(level);
         }
 
-    };
+        static SimdLevel simdLevel() { return simd_level_; }
 
-    std::unordered_map<char, MessageFactory::MessageCreator> MessageFactory::messageCreators_;
-    std::unordered_map<char, int> MessageFactory::messageSizes_;
-
-    void registerMessageCreators() {
-        MessageFactory::registerMessageCreator('R', +[](const std::byte*& data) -> std::unique_ptr<ItchMessage> {
-            return std::make_unique<StockDirectoryMessage>(data);
-            });
-        MessageFactory::registerMessageCreator('A', +[](const std::byte*& data) -> std::unique_ptr<ItchMessage> {
-            return std::make_unique<AddOrderMessage>(data);
-            });
-        MessageFactory::registerMessageCreator('F', +[](const std::byte*& data) -> std::unique_ptr<ItchMessage> {
-            return std::make_unique<AddOrderMPIDAttributionMessage>(data);
-            });
-        MessageFactory::registerMessageCreator('E', +[](const std::byte*& data) -> std::unique_ptr<ItchMessage> {
-            return std::make_unique<OrderExecutedMessage>(data);
-            });
-        MessageFactory::registerMessageCreator('C', +[](const std::byte*& data) -> std::unique_ptr<ItchMessage> {
-            return std::make_unique<OrderExecutedWithPriceMessage>(data);
-            });
-        MessageFactory::registerMessageCreator('U', +[](const std::byte*& data) -> std::unique_ptr<ItchMessage> {
-            return std::make_unique<OrderReplaceMessage>(data);
-            });
-        MessageFactory::registerMessageCreator('P', +[](const std::byte*& data) -> std::unique_ptr<ItchMessage> {
-            return std::make_unique<NonCrossTradeMessage>(data);
-            });
-        MessageFactory::registerMessageCreator('Q', +[](const std::byte*& data) -> std::unique_ptr<ItchMessage> {
-            return std::make_unique<CrossTradeMessage>(data);
-            });
-        MessageFactory::registerMessageCreator('B', +[](const std::byte*& data) -> std::unique_ptr<ItchMessage> {
-            return std::make_unique<BrokenTradeMessage>(data);
-            });
-    }
+        // True if the type has a decoder; other known types are only ever skipped
+        static constexpr bool isDecoded(char messageType) {
+            return kMessageTable[static_cast<unsigned char>(messageType)].decode != nullptr;
+        }
+
+        // Size of the message after the type byte, 0 for unknown types
+        static constexpr size_t getMessageSize(char messageType) {
+            return kMessageTable[static_cast<unsigned char>(messageType)].size;
+        }
+
+    private:
+        static inline SimdLevel simd_level_ = SimdLevel::Scalar;
+        static inline MessageDecoderTable decoders_ = makeMessageDecoders(SimdLevel::Scalar);
+    };
 }
 
 #endif
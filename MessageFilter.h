@@ -0,0 +1,151 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 16:05:37
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 16:05:37
+ */
+
+#ifndef MESSAGE_FILTER_H
+#define MESSAGE_FILTER_H
+
+#include <bitset>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_set>
+#include <stdexcept>
+
+#include "Message.h"
+
+namespace GuG {
+
+    // The stocks a run is restricted to. Symbols are matched to stock locates by the stock
+    // directory (R) messages in feed order; every other message of a locate is dropped before it
+    // is decoded unless the locate's directory entry lists a selected symbol. A locate is
+    // assigned once a day, so messages of a locate before its directory entry are dropped too.
+    // Locate states are atomic: decoders running ahead of the feed order read them while the
+    // thread that forwards the feed in order resolves them.
+    class SymbolFilter {
+    public:
+        explicit SymbolFilter(const std::vector<std::string>& symbols)
+            : symbols_(symbols.begin(), symbols.end()), states_(new std::atomic<uint8_t>[kLocates]) {
+            for (size_t locate = 0; locate < kLocates; ++locate) {
+                states_[locate].store(kUnknown, std::memory_order_relaxed);
+            }
+        }
+
+        // Records the locate of a directory entry; true if its symbol is selected
+        bool resolve(uint16_t locate, const StockSymbol& symbol) {
+            bool selected = symbols_.count(std::string(symbol.view())) != 0;
+            states_[locate].store(selected ? kSelected : kDropped, std::memory_order_relaxed);
+            return selected;
+        }
+
+        // Locates resolved earlier, such as those of a resumed run's symbol tables
+        void select(uint16_t locate) { states_[locate].store(kSelected, std::memory_order_relaxed); }
+
+        bool selected(uint16_t locate) const { return states_[locate].load(std::memory_order_relaxed) == kSelected; }
+
+        // Resolved to a symbol that is not selected
+        bool dropped(uint16_t locate) const { return states_[locate].load(std::memory_order_relaxed) == kDropped; }
+
+        size_t size() const { return symbols_.size(); }
+
+    private:
+        static constexpr size_t kLocates = 1u << 16;
+        static constexpr uint8_t kUnknown = 0;
+        static constexpr uint8_t kSelected = 1;
+        static constexpr uint8_t kDropped = 2;
+
+        std::unordered_set<std::string> symbols_;
+        std::unique_ptr<std::atomic<uint8_t>[]> states_;
+    };
+
+    // The message types the reader decodes and forwards. Frames of every other type are
+    // skipped using only their length, before any field is read.
+    class MessageFilter {
+    public:
+        // Every type MessageFactory can decode: the behaviour without a filter
+        static MessageFilter all() {
+            MessageFilter filter;
+            for (int type = 0; type < 256; ++type) {
+                if (MessageFactory::isDecoded(static_cast<char>(type))) {
+                    filter.types_[type] = true;
+                }
+            }
+            return filter;
+        }
+
+        // Types that change the VWAP. Delete (D) and Cancel (X) only remove orders from the order
+        // table, so they are needed only to keep it down to the live orders.
+        static MessageFilter vwap(bool order_tracking) {
+            MessageFilter filter = fromTypes("RAFECUPQB");
+            if (order_tracking) {
+                filter.allow('D');
+                filter.allow('X');
+            }
+            return filter;
+        }
+
+        // Throws std::invalid_argument for types that are never decoded
+        static MessageFilter fromTypes(std::string_view types) {
+            MessageFilter filter;
+            for (char type : types) {
+                if (!MessageFactory::isDecoded(type)) {
+                    throw std::invalid_argument(std::string("Message type is not decoded: ") + type);
+                }
+                filter.allow(type);
+            }
+            return filter;
+        }
+
+        void allow(char type) { types_[static_cast<unsigned char>(type)] = true; }
+
+        // Decodes only the messages of the stocks in `symbols`, and their directory messages.
+        // Copies of the filter share the locates resolved so far.
+        void restrict(std::shared_ptr<SymbolFilter> symbols) {
+            allow('R');
+            symbols_ = std::move(symbols);
+        }
+
+        const std::shared_ptr<SymbolFilter>& symbols() const { return symbols_; }
+
+        // A copy for decoding ahead of the feed order: it resolves no locates and only drops the
+        // messages of locates already resolved to other symbols, the rest is left to the filter
+        // of the thread that forwards the feed in order (see ParallelFrameDecoder)
+        MessageFilter lookahead() const {
+            MessageFilter filter = *this;
+            filter.resolves_ = false;
+            return filter;
+        }
+
+        // False for a lookahead() copy
+        bool resolves() const { return resolves_; }
+
+        // True if a decoded frame with this type and locate is dropped. A directory message is
+        // only dropped once resolve() has been given its symbol.
+        bool dropsLocate(char type, uint16_t locate) const {
+            if (!symbols_ || type == 'R') return false;
+            return resolves_ ? !symbols_->selected(locate) : symbols_->dropped(locate);
+        }
+
+        // Directory messages resolve their locate; false if the stock is not selected
+        bool resolve(const StockDirectoryMessage& directory) const {
+            return !symbols_ || !resolves_ || symbols_->resolve(directory.stock_id, directory.stock_symbol);
+        }
+
+        bool allows(char type) const { return types_[static_cast<unsigned char>(type)]; }
+
+        // True if messages of this type are decoded without the filter but skipped with it
+        bool drops(char type) const { return !allows(type) && MessageFactory::isDecoded(type); }
+
+    private:
+        std::bitset<256> types_;
+        std::shared_ptr<SymbolFilter> symbols_;
+        bool resolves_ = true;
+    };
+}
+
+#endif
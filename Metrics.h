@@ -0,0 +1,353 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 21:44:30
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 21:44:30
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>   // For sysconf
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "Message.h"
+
+namespace GuG {
+
+    // Hot path metrics are only compiled in with -DGUG_WITH_METRICS. Without it every type below
+    // is an empty class whose hooks are empty inline functions, so instrumented code compiles to
+    // exactly what it was before.
+#ifdef GUG_WITH_METRICS
+    constexpr bool kMetricsEnabled = true;
+#else
+    constexpr bool kMetricsEnabled = false;
+#endif
+
+    inline uint64_t readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    namespace detail {
+        // Counters are written by one thread and read by the sampler: relaxed load and store,
+        // no locked read-modify-write on the hot path
+        inline void bump(std::atomic<uint64_t>& counter, uint64_t by = 1) {
+            counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+        }
+
+        inline void raise(std::atomic<uint64_t>& counter, uint64_t value) {
+            if (value > counter.load(std::memory_order_relaxed)) counter.store(value, std::memory_order_relaxed);
+        }
+
+        inline uint64_t get(const std::atomic<uint64_t>& counter) {
+            return counter.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Power of two histogram of cycle counts: bucket b holds values in [2^(b-1), 2^b)
+    class CycleHistogram {
+    public:
+        void record(uint64_t cycles) {
+            detail::bump(buckets_[std::bit_width(cycles)]);
+        }
+
+        uint64_t count() const {
+            uint64_t total = 0;
+            for (const auto& bucket : buckets_) total += detail::get(bucket);
+            return total;
+        }
+
+        // Upper bound of the bucket holding the q-quantile, in cycles
+        uint64_t quantile(double q) const {
+            uint64_t total = count();
+            uint64_t seen = 0;
+            for (size_t b = 0; b < buckets_.size(); ++b) {
+                seen += detail::get(buckets_[b]);
+                if (total != 0 && seen >= q * total) return b == 0 ? 0 : (b >= 64 ? UINT64_MAX : (uint64_t{ 1 } << b) - 1);
+            }
+            return 0;
+        }
+
+        uint64_t bucket(size_t b) const { return detail::get(buckets_[b]); }
+        static constexpr size_t size() { return 65; }
+
+    private:
+        std::array<std::atomic<uint64_t>, 65> buckets_{};
+    };
+
+    template<bool Enabled>
+    class BasicReaderMetrics {
+    public:
+        void decoded(char type) { detail::bump(decoded_[static_cast<unsigned char>(type)]); }
+        void skipped(char type) { detail::bump(skipped_[static_cast<unsigned char>(type)]); }
+        void bytes(uint64_t count) { detail::bump(bytes_, count); }
+
+        uint64_t decodedCount(char type) const { return detail::get(decoded_[static_cast<unsigned char>(type)]); }
+        uint64_t skippedCount(char type) const { return detail::get(skipped_[static_cast<unsigned char>(type)]); }
+        uint64_t byteCount() const { return detail::get(bytes_); }
+
+    private:
+        std::array<std::atomic<uint64_t>, 256> decoded_{};
+        std::array<std::atomic<uint64_t>, 256> skipped_{};
+        std::atomic<uint64_t> bytes_{ 0 };
+    };
+
+    template<>
+    class BasicReaderMetrics<false> {
+    public:
+        void decoded(char) {}
+        void skipped(char) {}
+        void bytes(uint64_t) {}
+    };
+
+    // One processor shard, plus the depth of its queue as seen by the reader
+    template<bool Enabled>
+    class BasicShardMetrics {
+    public:
+        // Reader side
+        void queueDepth(size_t depth) { detail::raise(queue_high_water_, depth); }
+
+        // Processor side. A popped batch is timed as a whole; probes in it give the handoff latency
+        uint64_t batchStart() { return readCycles(); }
+        void batchEnd(uint64_t start, size_t messages) {
+            if (messages == 0) return;
+            processing_.record((readCycles() - start) / messages);
+            detail::bump(messages_, messages);
+        }
+        void probe(uint64_t popped, uint64_t pushed) { handoff_.record(popped > pushed ? popped - pushed : 0); }
+        void unmatchedOrder() { detail::bump(unmatched_orders_); }
+        void unmatchedBreak() { detail::bump(unmatched_breaks_); }
+        void tableSizes(size_t orders, size_t journal) {
+            order_table_size_.store(orders, std::memory_order_relaxed);
+            journal_size_.store(journal, std::memory_order_relaxed);
+        }
+
+        uint64_t queueHighWater() const { return detail::get(queue_high_water_); }
+        uint64_t messages() const { return detail::get(messages_); }
+        uint64_t unmatchedOrders() const { return detail::get(unmatched_orders_); }
+        uint64_t unmatchedBreaks() const { return detail::get(unmatched_breaks_); }
+        uint64_t orderTableSize() const { return detail::get(order_table_size_); }
+        uint64_t journalSize() const { return detail::get(journal_size_); }
+        const CycleHistogram& handoff() const { return handoff_; }
+        const CycleHistogram& processing() const { return processing_; }
+
+    private:
+        std::atomic<uint64_t> queue_high_water_{ 0 };
+        std::atomic<uint64_t> messages_{ 0 };
+        std::atomic<uint64_t> unmatched_orders_{ 0 };
+        std::atomic<uint64_t> unmatched_breaks_{ 0 };
+        std::atomic<uint64_t> order_table_size_{ 0 };
+        std::atomic<uint64_t> journal_size_{ 0 };
+        CycleHistogram handoff_;
+        CycleHistogram processing_;
+    };
+
+    template<>
+    class BasicShardMetrics<false> {
+    public:
+        void queueDepth(size_t) {}
+        uint64_t batchStart() { return 0; }
+        void batchEnd(uint64_t, size_t) {}
+        void probe(uint64_t, uint64_t) {}
+        void unmatchedOrder() {}
+        void unmatchedBreak() {}
+        void tableSizes(size_t, size_t) {}
+    };
+
+    // Owns the reader's and every shard's metrics, samples them on a background thread every
+    // `interval` and writes everything as JSON once the job is over
+    template<bool Enabled>
+    class BasicPipelineMetrics {
+    public:
+        using ShardMetrics = BasicShardMetrics<Enabled>;
+
+        BasicPipelineMetrics(size_t shards, std::chrono::milliseconds interval)
+            : interval_(interval), start_time_(std::chrono::steady_clock::now()), start_cycles_(readCycles()) {
+            for (size_t i = 0; i < shards; ++i) {
+                shards_.push_back(std::make_unique<ShardMetrics>());
+            }
+            sampler_ = std::thread([this] { sampleLoop(); });
+        }
+
+        ~BasicPipelineMetrics() { stop(); }
+
+        BasicPipelineMetrics(const BasicPipelineMetrics&) = delete;
+        BasicPipelineMetrics& operator=(const BasicPipelineMetrics&) = delete;
+
+        BasicReaderMetrics<Enabled>& reader() { return reader_; }
+        ShardMetrics& shard(size_t i) { return *shards_[i]; }
+
+        // Stops sampling and writes the report; false if the file could not be written
+        bool writeJson(const std::string& path) {
+            stop();
+            takeSample();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+            double cycles_per_ns = (readCycles() - start_cycles_) / (seconds * 1e9);
+
+            std::ofstream out(path, std::ios::out | std::ios::trunc);
+            out << "{\n  \"seconds\": " << seconds << ",\n  \"cycles_per_ns\": " << cycles_per_ns
+                << ",\n  \"bytes\": " << reader_.byteCount() << ",\n  \"decoded\": ";
+            writeTypeCounts(out, [this](char type) { return reader_.decodedCount(type); });
+            out << ",\n  \"skipped\": ";
+            writeTypeCounts(out, [this](char type) { return reader_.skippedCount(type); });
+            out << ",\n  \"shards\": [";
+            for (size_t i = 0; i < shards_.size(); ++i) {
+                const ShardMetrics& shard = *shards_[i];
+                out << (i ? "," : "") << "\n    {\"messages\": " << shard.messages()
+                    << ", \"queue_high_water\": " << shard.queueHighWater()
+                    << ", \"unmatched_orders\": " << shard.unmatchedOrders()
+                    << ", \"unmatched_breaks\": " << shard.unmatchedBreaks()
+                    << ", \"order_table_size\": " << shard.orderTableSize()
+                    << ", \"journal_size\": " << shard.journalSize()
+                    << ",\n     \"handoff_cycles\": ";
+                writeHistogram(out, shard.handoff());
+                out << ",\n     \"processing_cycles_per_message\": ";
+                writeHistogram(out, shard.processing());
+                out << "}";
+            }
+            out << "\n  ],\n  \"samples\": [";
+            for (size_t i = 0; i < samples_.size(); ++i) {
+                const Sample& sample = samples_[i];
+                out << (i ? "," : "") << "\n    {\"ms\": " << sample.ms << ", \"bytes\": " << sample.bytes
+                    << ", \"messages\": " << sample.messages << ", \"order_table_size\": " << sample.orders
+                    << ", \"journal_size\": " << sample.journal << ", \"rss_kb\": " << sample.rss_kb << "}";
+            }
+            out << "\n  ]\n}\n";
+            return static_cast<bool>(out.flush());
+        }
+
+    private:
+        struct Sample {
+            uint64_t ms;
+            uint64_t bytes;
+            uint64_t messages;   // processed by all shards
+            uint64_t orders;     // live orders in all order tables
+            uint64_t journal;    // trades in all match journals
+            uint64_t rss_kb;
+        };
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopped_) return;
+                stopped_ = true;
+            }
+            wake_.notify_all();
+            sampler_.join();
+        }
+
+        void sampleLoop() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!wake_.wait_for(lock, interval_, [this] { return stopped_; })) {
+                lock.unlock();
+                takeSample();
+                lock.lock();
+            }
+        }
+
+        void takeSample() {
+            Sample sample{};
+            sample.ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start_time_).count());
+            sample.bytes = reader_.byteCount();
+            for (const auto& shard : shards_) {
+                sample.messages += shard->messages();
+                sample.orders += shard->orderTableSize();
+                sample.journal += shard->journalSize();
+            }
+            sample.rss_kb = residentKb();
+            samples_.push_back(sample);
+        }
+
+        // Current resident set from /proc/self/statm, 0 where it does not exist
+        static uint64_t residentKb() {
+            unsigned long pages = 0, resident = 0;
+            FILE* statm = std::fopen("/proc/self/statm", "r");
+            if (statm == nullptr) return 0;
+            int fields = std::fscanf(statm, "%lu %lu", &pages, &resident);
+            std::fclose(statm);
+            return fields == 2 ? resident * (sysconf(_SC_PAGESIZE) / 1024) : 0;
+        }
+
+        template<typename Count>
+        static void writeTypeCounts(std::ostream& out, Count&& count) {
+            out << "{";
+            bool first = true;
+            for (int type = 'A'; type <= 'z'; ++type) {
+                uint64_t value = count(static_cast<char>(type));
+                if (value == 0) continue;
+                out << (first ? "" : ", ") << "\"" << static_cast<char>(type) << "\": " << value;
+                first = false;
+            }
+            out << "}";
+        }
+
+        static void writeHistogram(std::ostream& out, const CycleHistogram& histogram) {
+            out << "{\"count\": " << histogram.count() << ", \"p50\": " << histogram.quantile(0.5)
+                << ", \"p90\": " << histogram.quantile(0.9) << ", \"p99\": " << histogram.quantile(0.99)
+                << ", \"max\": " << histogram.quantile(1.0) << ", \"log2_buckets\": [";
+            size_t last = 0;
+            for (size_t b = 0; b < CycleHistogram::size(); ++b) {
+                if (histogram.bucket(b) != 0) last = b;
+            }
+            for (size_t b = 0; b <= last; ++b) {
+                out << (b ? ", " : "") << histogram.bucket(b);
+            }
+            out << "]}";
+        }
+
+        const std::chrono::milliseconds interval_;
+        const std::chrono::steady_clock::time_point start_time_;
+        const uint64_t start_cycles_;
+        BasicReaderMetrics<Enabled> reader_;
+        std::vector<std::unique_ptr<ShardMetrics>> shards_;
+        std::vector<Sample> samples_;   // only touched by the sampler, then by writeJson after stop
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        bool stopped_ = false;
+        std::thread sampler_;
+    };
+
+    template<>
+    class BasicPipelineMetrics<false> {
+    public:
+        using ShardMetrics = BasicShardMetrics<false>;
+
+        BasicPipelineMetrics(size_t, std::chrono::milliseconds) {}
+
+        BasicReaderMetrics<false>& reader() { return reader_; }
+        ShardMetrics& shard(size_t) { return shard_; }
+        bool writeJson(const std::string&) { return false; }
+
+    private:
+        BasicReaderMetrics<false> reader_;
+        ShardMetrics shard_;
+    };
+
+    using ReaderMetrics = BasicReaderMetrics<kMetricsEnabled>;
+    using ShardMetrics = BasicShardMetrics<kMetricsEnabled>;
+    using PipelineMetrics = BasicPipelineMetrics<kMetricsEnabled>;
+}
+
+#endif
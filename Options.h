@@ -0,0 +1,498 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 09:40:05
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 22:06:15
+ */
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <sys/stat.h>
+#include <thread>
+
+#include "SimdDecode.h"
+#include "MessageFilter.h"
+#include "TimeBuckets.h"
+#include "SpscRingBuffer.h"
+
+namespace GuG {
+
+    // Which queue hands messages from the reader thread to the processor thread
+    enum class QueueKind {
+        Mutex,  // ThreadSafeQueue: unbounded, mutex + condition variable
+        Spsc    // SpscRingBuffer: bounded, lock-free
+    };
+
+    // How an uncompressed feed file is read
+    enum class InputBackend {
+        Mmap,       // the whole file mapped, pages stay resident once read
+        MmapWindow, // mapped with sequential advice, prefetched ahead and released behind the parser
+        Pread,      // FileBlockReader: blocks read by a background thread
+        Direct,     // FileBlockReader: the same with O_DIRECT, bypassing the page cache
+        Uring       // FileBlockReader: io_uring reads queued ahead of the parser
+    };
+
+    // Which message types the reader decodes
+    enum class FilterKind {
+        Vwap,   // types that affect the VWAP, D/X only with order tracking
+        All,    // every decoded type
+        Custom  // the types listed in Options::filter_types
+    };
+
+    struct Options {
+        const char* file_path = "01302019.NASDAQ_ITCH50";
+        QueueKind queue_kind = QueueKind::Spsc;
+        size_t queue_capacity = 1u << 16;
+        size_t expected_orders = 1u << 20;  // live orders the order table is pre-sized for
+        uint64_t journal_horizon = 1u << 22; // match numbers a Broken Trade can reach back, per shard
+        size_t prefetch_batch = 16;         // messages whose table slots are prefetched ahead, 0 for none
+        InputBackend input_backend = InputBackend::Mmap;
+        size_t read_block = 4u << 20;       // bytes per read, or per slice of a windowed mapping
+        size_t read_ahead = 4;              // blocks read or prefetched ahead of the parser
+        size_t threads = 1;                 // processor shards, partitioned by stock locate
+        size_t parse_threads = 1;           // > 1 decodes file chunks in parallel
+        SimdLevel decoder = SimdLevel::Scalar; // field readers; the vector decoders are opt-in
+        FilterKind filter = FilterKind::Vwap;
+        std::string filter_types;
+        bool order_tracking = true;         // decode D/X so the order table only holds live orders
+        std::vector<std::string> symbols;   // only these stocks are decoded, all if empty
+        TimeBuckets buckets;                // hourly VWAP without a rolling window
+        bool follow = false;                // keep reading a growing file until End of Messages
+        uint64_t publish_interval = 100000000ULL;   // streaming input: max delay of live_output, ns
+        std::string live_output = "live_vwap.csv";
+        size_t inflate_threads = 4;         // gzip input: threads inflating BGZF members
+        std::string binary_output;          // columnar store written next to output.csv, off if empty
+        std::string convert_path;           // print this store as CSV instead of processing a feed
+        std::string metrics_path;           // metrics builds: JSON report written at exit, off if empty
+        uint64_t metrics_interval = 1000000000ULL;  // metrics builds: sampling period, ns
+        std::string checkpoint_path;        // mapped file input: periodic checkpoint, off if empty
+        uint64_t checkpoint_interval = 60000000000ULL;  // time between checkpoints, ns
+        std::string resume_path;            // checkpoint to pick the input up from, off if empty
+        std::string build_index_path;       // write a FeedIndex of the input here and exit
+        uint64_t index_interval = 60000000000ULL;   // FeedIndex: ns between bucket offsets
+        std::string index_path;             // FeedIndex the query runs on
+        std::string query_symbol;           // print this symbol's VWAP over [query_from, query_to) and exit
+        uint64_t query_from = 0;
+        uint64_t query_to = kNanosPerDay;
+        std::string output_path = "output.csv";
+        std::vector<std::string> inputs;    // every itchDatafile argument, more than one only in batch mode
+        std::string batch_dir;              // run every input as its own job, writing outputs here
+        std::string batch_list;             // file listing batch inputs or glob patterns, one per line
+        std::string batch_summary;          // batch: CSV with a line per input, off if empty
+        size_t jobs = std::max(1u, std::thread::hardware_concurrency());  // batch: jobs run at once
+        uint64_t memory_limit = 0;          // batch: bytes the running jobs' estimates may add up to, 0 for 3/4 of RAM
+        std::vector<std::string> child_args;    // batch: the options every job is run with
+    };
+
+    // Gzip files are recognised by their magic bytes, whatever their name
+    bool isGzipInput(const Options& options) {
+        std::ifstream in(options.file_path, std::ios::binary);
+        unsigned char magic[2] = {};
+        return in.read(reinterpret_cast<char*>(magic), 2) && magic[0] == 0x1f && magic[1] == 0x8b;
+    }
+
+    // stdin ("-"), a named pipe or a followed file is read as a stream instead of being mapped
+    bool isStreamInput(const Options& options) {
+        struct stat sb;
+        return options.follow || std::string(options.file_path) == "-"
+            || (stat(options.file_path, &sb) == 0 && S_ISFIFO(sb.st_mode));
+    }
+
+    // Every call gets its own symbol list, shared only by copies of the filter it returns
+    MessageFilter makeMessageFilter(const Options& options) {
+        MessageFilter filter;
+        switch (options.filter) {
+        case FilterKind::All: filter = MessageFilter::all(); break;
+        case FilterKind::Custom: filter = MessageFilter::fromTypes(options.filter_types); break;
+        default: filter = MessageFilter::vwap(options.order_tracking); break;
+        }
+        if (!options.symbols.empty()) {
+            filter.restrict(std::make_shared<SymbolFilter>(options.symbols));
+        }
+        return filter;
+    }
+
+    void printUsage(const char* program, std::ostream& out = std::cerr) {
+        out << "Usage: " << program << " [options] [itchDatafile]\n"
+            << "  --queue <spsc|mutex>     reader to processor handoff (default spsc)\n"
+            << "  --queue-capacity <n>     spsc ring size in messages, at least 256 (default 65536)\n"
+            << "  --expected-orders <n>    pre-size the order table for n live orders (default 1048576)\n"
+            << "  --journal-horizon <n>    trades of the last n match numbers can be broken (default 4194304)\n"
+            << "  --prefetch-batch <n>     messages whose order and symbol slots are prefetched ahead of processing, 0 for none (default 16)\n"
+            << "  --reader <backend>       how the file is read: mmap (default), mmap-window (bounded RSS),\n"
+            << "                           pread, direct (pread with O_DIRECT) or io_uring\n"
+            << "  --read-block <size>      bytes per read or per released window slice (default 4M)\n"
+            << "  --read-ahead <n>         blocks read or prefetched ahead of the parser (default 4)\n"
+            << "  --threads <n>            processor threads, stocks are sharded by locate (default 1)\n"
+            << "  --parse-threads <n>      threads decoding file chunks in parallel (default 1)\n"
+            << "  --decoder <level>        scalar, ssse3, avx2 or auto (best the CPU supports) message decoders (default scalar)\n"
+            << "  --filter <set>           message types decoded: vwap, all or a list such as RAFECUPQB (default vwap)\n"
+            << "  --order-tracking <on|off> decode D/X to drop deleted orders from the order table (default on)\n"
+            << "  --symbols <list>         only process these stocks, such as AAPL,MSFT (repeatable)\n"
+            << "  --symbols-file <path>    only process the stocks listed in path, separated by spaces, commas or lines\n"
+            << "  --bucket <duration>      VWAP bucket width such as 1m, 5m, 30s or 250ms (default 1h)\n"
+            << "  --window <duration>      add a rolling VWAP over this window, a multiple of the bucket width\n"
+            << "  --follow                 keep reading the file as it grows, until its End of Messages event\n"
+            << "  --publish-interval <duration> streaming input: max delay of the live snapshot (default 100ms)\n"
+            << "  --live-output <path>     streaming input: snapshot of the open bucket (default live_vwap.csv)\n"
+            << "  --inflate-threads <n>    threads inflating a BGZF compressed file (default 4)\n"
+            << "  --binary-output <path>   also write the results as a columnar store that can be mapped\n"
+            << "  --to-csv <path>          print a store written by --binary-output as output.csv and exit\n"
+            << "  --build-index <path>     write a time and symbol index of itchDatafile and exit\n"
+            << "  --index-interval <duration> index: time between the points a query can start from (default 1m)\n"
+            << "  --query <symbol>         print the symbol's VWAP from --from to --to using --index, and exit\n"
+            << "  --index <path>           index written by --build-index for itchDatafile\n"
+            << "  --from <HH:MM[:SS]>      start of the query range (default 00:00)\n"
+            << "  --to <HH:MM[:SS]>        end of the query range, exclusive (default 24:00)\n"
+            << "  --output <path>          CSV output file (default output.csv)\n"
+            << "  --batch <dir>            run each itchDatafile (paths or glob patterns) as its own job,\n"
+            << "                           writing dir/<name>.csv and dir/<name>.log\n"
+            << "  --batch-list <path>      batch: also run the files or glob patterns listed in path, one per line\n"
+            << "  --jobs <n>               batch: jobs run at once (default: number of CPUs)\n"
+            << "  --memory-limit <size>    batch: memory the running jobs may use, such as 48G (default 3/4 of RAM)\n"
+            << "  --batch-summary <path>   batch: write a CSV line per file with its exit code, time and peak RSS\n"
+            << "  --metrics <path>         write hot path metrics as JSON at exit (build with -DGUG_WITH_METRICS)\n"
+            << "  --metrics-interval <duration> how often metrics are sampled (default 1s)\n"
+            << "  --checkpoint <path>      periodically save the processing state to path (uncompressed files)\n"
+            << "  --checkpoint-interval <duration> time between checkpoints (default 1m)\n"
+            << "  --resume <path>          continue output.csv from a checkpoint saved by --checkpoint\n"
+            << "Pass - as itchDatafile to read stdin; named pipes are read as streams too.\n"
+            << "Gzip compressed files are decompressed on the fly.\n";
+    }
+
+    uint64_t parseUnsigned(const std::string& option, const std::string& value) {
+        size_t pos = 0;
+        uint64_t result = 0;
+        try {
+            result = std::stoull(value, &pos);
+        }
+        catch (const std::exception&) {
+            pos = 0;
+        }
+        if (pos != value.size() || value.empty() || value[0] == '-') {
+            throw std::invalid_argument("Invalid value for " + option + ": " + value);
+        }
+        return result;
+    }
+
+    // A whole number followed by ms, s, m or h, in nanoseconds
+    uint64_t parseDuration(const std::string& option, const std::string& value) {
+        size_t digits = value.find_first_not_of("0123456789");
+        std::string unit = digits == std::string::npos ? "" : value.substr(digits);
+        uint64_t scale = unit == "ms" ? 1000000ULL : unit == "s" ? 1000000000ULL
+            : unit == "m" ? 60000000000ULL : unit == "h" ? kNanosPerHour : 0;
+        if (scale == 0 || digits == 0) {
+            throw std::invalid_argument("Invalid duration for " + option + ": " + value);
+        }
+        uint64_t count = parseUnsigned(option, value.substr(0, digits));
+        if (count == 0 || count > kNanosPerDay / scale) {
+            throw std::invalid_argument(option + " must be between 1ms and 24h");
+        }
+        return count * scale;
+    }
+
+    // A whole number of bytes, optionally followed by K, M or G
+    uint64_t parseSize(const std::string& option, const std::string& value) {
+        size_t digits = value.find_first_not_of("0123456789");
+        std::string unit = digits == std::string::npos ? "" : value.substr(digits);
+        int shift = unit.empty() ? 0 : unit == "K" ? 10 : unit == "M" ? 20 : unit == "G" ? 30 : -1;
+        if (shift < 0 || digits == 0) {
+            throw std::invalid_argument("Invalid size for " + option + ": " + value);
+        }
+        uint64_t count = parseUnsigned(option, value.substr(0, digits));
+        if (count > (UINT64_MAX >> shift)) {
+            throw std::invalid_argument("Invalid size for " + option + ": " + value);
+        }
+        return count << shift;
+    }
+
+    // HH:MM or HH:MM:SS, in nanoseconds after midnight, up to 24:00
+    uint64_t parseClock(const std::string& option, const std::string& value) {
+        unsigned hours = 0, minutes = 0, seconds = 0;
+        int used = 0;
+        int fields = std::sscanf(value.c_str(), "%2u:%2u%n:%2u%n", &hours, &minutes, &used, &seconds, &used);
+        uint64_t time = ((hours * 60ULL + minutes) * 60 + seconds) * 1000000000ULL;
+        if (fields < 2 || static_cast<size_t>(used) != value.size() || minutes > 59 || seconds > 59 || time > kNanosPerDay) {
+            throw std::invalid_argument("Invalid time for " + option + ": " + value);
+        }
+        return time;
+    }
+
+    // Appends the symbols in text, separated by commas or whitespace
+    void addSymbols(std::vector<std::string>& symbols, const std::string& text) {
+        size_t pos = 0;
+        while ((pos = text.find_first_not_of(", \t\r\n", pos)) != std::string::npos) {
+            size_t stop = std::min(text.find_first_of(", \t\r\n", pos), text.size());
+            std::string symbol = text.substr(pos, stop - pos);
+            if (symbol.size() > sizeof(StockSymbol::value)) {
+                throw std::invalid_argument("Stock symbols have at most 8 characters: " + symbol);
+            }
+            symbols.push_back(symbol);
+            pos = stop;
+        }
+    }
+
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        bool has_file = false;
+        bool has_expected_orders = false;
+        uint64_t window = 0;
+        for (int i = 1; i < argc; ++i) {
+            const int first = i;
+            bool forward = true;    // batch jobs are run with this option
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("Missing value for " + arg);
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--queue") {
+                std::string kind = value();
+                if (kind == "spsc") options.queue_kind = QueueKind::Spsc;
+                else if (kind == "mutex") options.queue_kind = QueueKind::Mutex;
+                else throw std::invalid_argument("Unknown queue: " + kind);
+            }
+            else if (arg == "--queue-capacity") {
+                options.queue_capacity = parseUnsigned(arg, value());
+                // a ring smaller than one router batch parks and wakes the reader for every chunk
+                if (options.queue_capacity < kQueueBatchSize) {
+                    throw std::invalid_argument("--queue-capacity must be at least " + std::to_string(kQueueBatchSize));
+                }
+            }
+            else if (arg == "--expected-orders") {
+                options.expected_orders = parseUnsigned(arg, value());
+                has_expected_orders = true;
+            }
+            else if (arg == "--journal-horizon") {
+                options.journal_horizon = parseUnsigned(arg, value());
+                if (options.journal_horizon == 0) {
+                    throw std::invalid_argument("--journal-horizon must be positive");
+                }
+            }
+            else if (arg == "--prefetch-batch") {
+                options.prefetch_batch = parseUnsigned(arg, value());
+            }
+            else if (arg == "--reader") {
+                std::string backend = value();
+                if (backend == "mmap") options.input_backend = InputBackend::Mmap;
+                else if (backend == "mmap-window") options.input_backend = InputBackend::MmapWindow;
+                else if (backend == "pread") options.input_backend = InputBackend::Pread;
+                else if (backend == "direct") options.input_backend = InputBackend::Direct;
+                else if (backend == "io_uring") options.input_backend = InputBackend::Uring;
+                else throw std::invalid_argument("Unknown reader: " + backend);
+            }
+            else if (arg == "--read-block") {
+                options.read_block = parseSize(arg, value());
+                if (options.read_block < 4096 || options.read_block > (1u << 30)) {
+                    throw std::invalid_argument("--read-block must be between 4K and 1G");
+                }
+            }
+            else if (arg == "--read-ahead") {
+                options.read_ahead = parseUnsigned(arg, value());
+                if (options.read_ahead == 0 || options.read_ahead > 1024) {
+                    throw std::invalid_argument("--read-ahead must be between 1 and 1024");
+                }
+            }
+            else if (arg == "--threads") {
+                options.threads = parseUnsigned(arg, value());
+                if (options.threads == 0) {
+                    throw std::invalid_argument("--threads must be positive");
+                }
+            }
+            else if (arg == "--parse-threads") {
+                options.parse_threads = parseUnsigned(arg, value());
+                if (options.parse_threads == 0) {
+                    throw std::invalid_argument("--parse-threads must be positive");
+                }
+            }
+            else if (arg == "--decoder") {
+                std::string level = value();
+                if (level == "auto") options.decoder = detectSimdLevel();
+                else if (level == "scalar") options.decoder = SimdLevel::Scalar;
+                else if (level == "ssse3") options.decoder = SimdLevel::Ssse3;
+                else if (level == "avx2") options.decoder = SimdLevel::Avx2;
+                else throw std::invalid_argument("Unknown decoder: " + level);
+                if (options.decoder > detectSimdLevel()) {
+                    throw std::invalid_argument("Decoder not supported by this CPU: " + level);
+                }
+            }
+            else if (arg == "--filter") {
+                std::string set = value();
+                if (set == "vwap") options.filter = FilterKind::Vwap;
+                else if (set == "all") options.filter = FilterKind::All;
+                else {
+                    MessageFilter::fromTypes(set);  // rejects types that are never decoded
+                    options.filter = FilterKind::Custom;
+                    options.filter_types = set;
+                }
+            }
+            else if (arg == "--order-tracking") {
+                std::string tracking = value();
+                if (tracking == "on") options.order_tracking = true;
+                else if (tracking == "off") options.order_tracking = false;
+                else throw std::invalid_argument("Invalid value for --order-tracking: " + tracking);
+            }
+            else if (arg == "--symbols") {
+                addSymbols(options.symbols, value());
+            }
+            else if (arg == "--symbols-file") {
+                std::string path = value();
+                std::ifstream file(path);
+                std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                if (!file.is_open() || file.bad()) {
+                    throw std::invalid_argument("Failed to read " + path);
+                }
+                addSymbols(options.symbols, text);
+                if (options.symbols.empty()) {
+                    throw std::invalid_argument(path + " lists no symbols");
+                }
+            }
+            else if (arg == "--bucket") {
+                options.buckets.width = parseDuration(arg, value());
+            }
+            else if (arg == "--window") {
+                window = parseDuration(arg, value());
+            }
+            else if (arg == "--inflate-threads") {
+                options.inflate_threads = parseUnsigned(arg, value());
+                if (options.inflate_threads == 0) {
+                    throw std::invalid_argument("--inflate-threads must be positive");
+                }
+            }
+            else if (arg == "--follow") {
+                options.follow = true;
+            }
+            else if (arg == "--publish-interval") {
+                options.publish_interval = parseDuration(arg, value());
+            }
+            else if (arg == "--live-output") {
+                options.live_output = value();
+            }
+            else if (arg == "--binary-output") {
+                options.binary_output = value();
+            }
+            else if (arg == "--to-csv") {
+                options.convert_path = value();
+            }
+            else if (arg == "--metrics") {
+                options.metrics_path = value();
+            }
+            else if (arg == "--metrics-interval") {
+                options.metrics_interval = parseDuration(arg, value());
+            }
+            else if (arg == "--checkpoint") {
+                options.checkpoint_path = value();
+            }
+            else if (arg == "--checkpoint-interval") {
+                options.checkpoint_interval = parseDuration(arg, value());
+            }
+            else if (arg == "--resume") {
+                options.resume_path = value();
+            }
+            else if (arg == "--build-index") {
+                options.build_index_path = value();
+            }
+            else if (arg == "--index-interval") {
+                options.index_interval = parseDuration(arg, value());
+            }
+            else if (arg == "--index") {
+                options.index_path = value();
+            }
+            else if (arg == "--query") {
+                options.query_symbol = value();
+            }
+            else if (arg == "--from") {
+                options.query_from = parseClock(arg, value());
+            }
+            else if (arg == "--to") {
+                options.query_to = parseClock(arg, value());
+            }
+            else if (arg == "--output") {
+                options.output_path = value();
+                forward = false;
+            }
+            else if (arg == "--batch") {
+                options.batch_dir = value();
+                forward = false;
+            }
+            else if (arg == "--batch-list") {
+                options.batch_list = value();
+                forward = false;
+            }
+            else if (arg == "--batch-summary") {
+                options.batch_summary = value();
+                forward = false;
+            }
+            else if (arg == "--jobs") {
+                options.jobs = parseUnsigned(arg, value());
+                if (options.jobs == 0) {
+                    throw std::invalid_argument("--jobs must be positive");
+                }
+                forward = false;
+            }
+            else if (arg == "--memory-limit") {
+                options.memory_limit = parseSize(arg, value());
+                forward = false;
+            }
+            else if (arg.size() > 1 && arg[0] == '-') {
+                throw std::invalid_argument("Unknown option: " + arg);
+            }
+            else {
+                if (!has_file) {
+                    options.file_path = argv[i];
+                    has_file = true;
+                }
+                options.inputs.push_back(arg);
+                forward = false;
+            }
+            if (forward) {
+                options.child_args.insert(options.child_args.end(), argv + first, argv + i + 1);
+            }
+        }
+        if (options.inputs.size() > 1 && options.batch_dir.empty()) {
+            throw std::invalid_argument("Unexpected argument: " + options.inputs[1]);
+        }
+        if (!options.batch_dir.empty()) {
+            if (options.follow || !options.checkpoint_path.empty() || !options.resume_path.empty() || !options.binary_output.empty()
+                || !options.metrics_path.empty() || !options.build_index_path.empty() || !options.query_symbol.empty()
+                || !options.convert_path.empty() || options.output_path != "output.csv") {
+                throw std::invalid_argument("--batch runs plain jobs: --follow, --checkpoint, --resume, --binary-output, "
+                    "--metrics, --build-index, --query, --to-csv and --output do not apply");
+            }
+        }
+        else if (!options.batch_list.empty() || !options.batch_summary.empty()) {
+            throw std::invalid_argument("--batch-list and --batch-summary need --batch");
+        }
+        if (window != 0) {
+            if (window % options.buckets.width != 0) {
+                throw std::invalid_argument("--window must be a multiple of --bucket");
+            }
+            options.buckets.window = static_cast<uint32_t>(window / options.buckets.width);
+        }
+        if (!options.symbols.empty() && !has_expected_orders) {
+            // the order table only holds the selected stocks' orders, and still grows if needed
+            options.expected_orders = std::min(options.expected_orders, std::max<size_t>(options.symbols.size() * 1024, 1u << 14));
+        }
+        if (!options.query_symbol.empty() && options.index_path.empty()) {
+            throw std::invalid_argument("--query needs --index");
+        }
+        if (options.query_from >= options.query_to) {
+            throw std::invalid_argument("--from must be before --to");
+        }
+        return options;
+    }
+}
+
+#endif
@@ -0,0 +1,446 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-17 01:36:50
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-17 01:36:50
+ */
+
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <charconv>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+
+#include "OrderTable.h"
+
+namespace GuG {
+
+#ifdef GUG_WITH_BOOK
+    constexpr bool kBookEnabled = true;
+#else
+    constexpr bool kBookEnabled = false;
+#endif
+
+    struct BookOrder {
+        uint64_t order_id;  // 0 marks an empty slot
+        uint32_t price;
+        uint32_t shares;    // remaining shares
+        uint16_t stock_id;
+        char side;          // 'B' or 'S', 0 for an order replacing one the book never saw
+    };
+    static_assert(sizeof(BookOrder) == 24);
+
+    // Aggregate of the live orders at one price
+    struct PriceLevel {
+        uint32_t key;       // price for bids, ~price for asks: the best level has the largest key
+        uint32_t orders;
+        uint64_t shares;
+    };
+    static_assert(sizeof(PriceLevel) == 16, "PriceLevel should stay one quarter of a cache line");
+
+    // One side of a stock's book. Levels are keyed so that the best price has the largest key.
+    // A thin side is a short sorted array of levels. Once it holds kLadderLevels levels, the keys
+    // of a window of kSpan prices around the touch index a flat ladder of levels directly, so an
+    // update there is one array access and the best level is found by a short scan of
+    // neighbouring slots. The ladder only covers the keys seen so far and grows towards the
+    // window's edges. Prices outside the window stay in the sorted array; once it has seen kSpan
+    // updates the window is moved to the current best price, which keeps rebuilding at O(1) per
+    // update while the touch drifts over the day.
+    class BookSide {
+    public:
+        static constexpr uint32_t kSpan = 4096;
+        static constexpr size_t kLadderLevels = 64;
+
+        explicit BookSide(bool bids = true) : bids_(bids) {}
+
+        void add(uint32_t price, uint64_t shares) {
+            uint32_t key = keyOf(price);
+            if (!inWindow(key)) {
+                addFar(key, 1, shares);
+                farUpdated();
+                return;
+            }
+            size_t i = slotOf(key);
+            if (ladder_[i].orders++ == 0) {
+                ++live_;
+                top_ = std::max(top_, i + 1);
+            }
+            ladder_[i].shares += shares;
+        }
+
+        // Takes shares of an order at price off its level; gone means the order left the book
+        void remove(uint32_t price, uint64_t shares, bool gone) {
+            uint32_t key = keyOf(price);
+            if (!inWindow(key)) {
+                removeFar(key, shares, gone);
+                farUpdated();
+                return;
+            }
+            size_t i = key - low_;
+            if (key < low_ || i >= ladder_.size() || ladder_[i].orders == 0) return;
+            Level& level = ladder_[i];
+            level.shares -= std::min(level.shares, shares);
+            if (!gone || --level.orders != 0) return;
+            level.shares = 0;
+            --live_;
+            if (i + 1 == top_) {
+                while (top_ > 0 && ladder_[top_ - 1].orders == 0) --top_;
+            }
+        }
+
+        // Starts loading the price's level if it is on the ladder
+        void prefetch(uint32_t price) const {
+            uint32_t key = keyOf(price);
+            if (inWindow(key) && key - low_ < ladder_.size()) __builtin_prefetch(&ladder_[key - low_], 1);
+        }
+
+        bool empty() const { return live_ == 0; }
+        size_t levels() const { return live_; }
+        uint32_t bestPrice() const { return priceOf(bestKey()); }
+
+        uint64_t bestShares() const {
+            uint32_t key = bestKey();
+            if (inWindow(key) && top_ > 0 && key == low_ + top_ - 1) return ladder_[top_ - 1].shares;
+            return far_.back().shares;
+        }
+
+        void clear() {
+            ladder_.clear();
+            far_.clear();
+            top_ = 0;
+            live_ = 0;
+            far_updates_ = 0;
+            laddered_ = false;
+        }
+
+    private:
+        struct Level {
+            uint64_t shares = 0;
+            uint32_t orders = 0;
+        };
+
+        uint32_t keyOf(uint32_t price) const { return bids_ ? price : ~price; }
+        uint32_t priceOf(uint32_t key) const { return bids_ ? key : ~key; }
+
+        bool inWindow(uint32_t key) const { return laddered_ && key - base_ < kSpan; }
+
+        // Largest key with orders; the side must not be empty
+        uint32_t bestKey() const {
+            // the overflow's levels lie outside the window, the ones above it are better
+            if (!far_.empty() && (top_ == 0 || far_.back().key > low_)) return far_.back().key;
+            return low_ + static_cast<uint32_t>(top_ - 1);
+        }
+
+        // Index of key's ladder slot, growing the ladder to reach it
+        size_t slotOf(uint32_t key) {
+            if (ladder_.empty()) {
+                low_ = key;
+                ladder_.resize(1);
+                return 0;
+            }
+            if (key < low_) {
+                // grow by half the ladder at least, so walking down the window costs O(1) per slot
+                uint32_t grow = std::max<uint32_t>(low_ - key, static_cast<uint32_t>(ladder_.size() / 2));
+                uint32_t low = std::max(base_, low_ - std::min(grow, low_ - base_));
+                ladder_.insert(ladder_.begin(), low_ - low, Level{});
+                if (top_ > 0) top_ += low_ - low;
+                low_ = low;
+            }
+            else if (key - low_ >= ladder_.size()) {
+                size_t size = std::max<size_t>(key - low_ + 1, ladder_.size() * 3 / 2);
+                ladder_.resize(std::min<size_t>(size, base_ + uint64_t{ kSpan } - low_));
+            }
+            return key - low_;
+        }
+
+        // Window of kSpan keys with key in the middle
+        void center(uint32_t key) {
+            uint64_t base = key > kSpan / 2 ? key - kSpan / 2 : 0;
+            base_ = static_cast<uint32_t>(std::min<uint64_t>(base, uint64_t{ UINT32_MAX } - kSpan + 1));
+        }
+
+        void addFar(uint32_t key, uint32_t orders, uint64_t shares) {
+            auto it = farLowerBound(key);
+            if (it != far_.end() && it->key == key) {
+                if (it->orders == 0) ++live_;
+                it->orders += orders;
+                it->shares += shares;
+            }
+            else {
+                far_.insert(it, PriceLevel{ key, orders, shares });
+                ++live_;
+            }
+        }
+
+        void removeFar(uint32_t key, uint64_t shares, bool gone) {
+            auto it = farLowerBound(key);
+            if (it == far_.end() || it->key != key) return;
+            it->shares -= std::min(it->shares, shares);
+            if (gone && --it->orders == 0) {
+                far_.erase(it);
+                --live_;
+            }
+        }
+
+        std::vector<PriceLevel>::iterator farLowerBound(uint32_t key) {
+            return std::lower_bound(far_.begin(), far_.end(), key,
+                [](const PriceLevel& level, uint32_t value) { return level.key < value; });
+        }
+
+        void farUpdated() {
+            if (++far_updates_ >= kSpan || (!laddered_ && far_.size() >= kLadderLevels)) recenter();
+        }
+
+        // Moves the window to the best price and redistributes the levels
+        void recenter() {
+            far_updates_ = 0;
+            if (live_ == 0) return;
+            uint32_t best = bestKey();
+            std::vector<PriceLevel> levels;
+            levels.swap(far_);
+            for (size_t i = 0; i < top_; ++i) {
+                if (ladder_[i].orders != 0) levels.push_back({ low_ + static_cast<uint32_t>(i), ladder_[i].orders, ladder_[i].shares });
+            }
+            ladder_.clear();
+            top_ = 0;
+            live_ = 0;
+            laddered_ = true;
+            center(best);
+            for (const PriceLevel& level : levels) {
+                if (!inWindow(level.key)) {
+                    addFar(level.key, level.orders, level.shares);
+                    continue;
+                }
+                size_t i = slotOf(level.key);
+                ladder_[i] = { level.shares, level.orders };
+                top_ = std::max(top_, i + 1);
+                ++live_;
+            }
+        }
+
+        bool bids_;
+        bool laddered_ = false;
+        uint32_t base_ = 0;         // first key of the window
+        uint32_t low_ = 0;          // key of ladder_[0]
+        std::vector<Level> ladder_; // keys low_ .. low_ + size - 1, all inside the window
+        size_t top_ = 0;            // one past the best ladder slot with orders, 0 if none
+        std::vector<PriceLevel> far_;
+        size_t live_ = 0;           // levels with orders
+        size_t far_updates_ = 0;
+    };
+
+    // Top of a stock's book, as reported next to the bucket's VWAP. Prices in 1/10000 dollars,
+    // 0 for an empty side
+    struct BookQuote {
+        uint32_t bid = 0;
+        uint32_t ask = 0;
+        uint64_t bid_shares = 0;
+        uint64_t ask_shares = 0;
+        uint32_t arrival_bid = 0;   // top of the book before the bucket's first trade
+        uint32_t arrival_ask = 0;
+    };
+
+    // Limit order books of every stock of a shard, driven by A/F/E/C/X/D/U. The live orders are
+    // kept in one pre-sized flat table with their stock, side and price, so an execution or
+    // cancel finds its level without a per stock lookup structure. In a book build it takes the
+    // place of the shard's OrderTable, so every order message costs one table lookup either way.
+    class OrderBook {
+    public:
+        explicit OrderBook(size_t expected_orders = 1u << 20) : orders_(expected_orders) {}
+
+        void add(uint16_t stock_id, uint64_t order_id, char side, uint32_t price, uint32_t shares) {
+            if (const BookOrder* old = orders_.find(order_id)) {
+                if (BookSide* levels = sideOf(*old)) levels->remove(old->price, old->shares, true);
+            }
+            orders_.insert(BookOrder{ order_id, price, shares, stock_id, side });
+            if (BookSide* levels = sideOf(stock_id, side)) levels->add(price, shares);
+        }
+
+        // Execution or cancel of part of an order; an order without shares left leaves the book.
+        // Returns the order's price like OrderTable::reduce, 0 if the order is unknown.
+        uint32_t reduce(uint64_t order_id, uint32_t shares) {
+            BookOrder* order = orders_.find(order_id);
+            if (order == nullptr) return 0;
+            uint32_t price = order->price;
+            bool gone = order->shares <= shares;
+            if (BookSide* levels = sideOf(*order)) levels->remove(price, std::min(order->shares, shares), gone);
+            if (gone) orders_.erase(order_id);
+            else order->shares -= shares;
+            return price;
+        }
+
+        bool erase(uint64_t order_id) {
+            const BookOrder* order = orders_.find(order_id);
+            if (order == nullptr) return false;
+            if (BookSide* levels = sideOf(*order)) levels->remove(order->price, order->shares, true);
+            orders_.erase(order_id);
+            return true;
+        }
+
+        // The new order keeps the side of the one it replaces. If that one is unknown (false) the
+        // new order is still kept for its price, like OrderTable does, but stays off the levels.
+        bool replace(uint16_t stock_id, uint64_t order_id, uint64_t new_order_id, uint32_t price, uint32_t shares) {
+            const BookOrder* order = orders_.find(order_id);
+            char side = 0;
+            if (order != nullptr) {
+                side = order->side;
+                if (BookSide* levels = sideOf(*order)) levels->remove(order->price, order->shares, true);
+                orders_.erase(order_id);
+            }
+            add(stock_id, new_order_id, side, price, shares);
+            return order != nullptr;
+        }
+
+        // Called before a trade of the stock is applied: the first trade of a bucket records
+        // the top of the book it arrived at
+        void arrive(uint16_t stock_id, uint32_t bucket) {
+            Book& book = bookOf(stock_id);
+            if (book.arrival_bucket == bucket) return;
+            book.arrival_bucket = bucket;
+            book.arrival_bid = book.bids.empty() ? 0 : book.bids.bestPrice();
+            book.arrival_ask = book.asks.empty() ? 0 : book.asks.bestPrice();
+        }
+
+        // The stock's top of book now, and where its first trade of bucket arrived
+        BookQuote quote(uint16_t stock_id, uint32_t bucket) const {
+            BookQuote top;
+            if (stock_id >= books_.size()) return top;
+            const Book& book = books_[stock_id];
+            if (!book.bids.empty()) {
+                top.bid = book.bids.bestPrice();
+                top.bid_shares = book.bids.bestShares();
+            }
+            if (!book.asks.empty()) {
+                top.ask = book.asks.bestPrice();
+                top.ask_shares = book.asks.bestShares();
+            }
+            if (book.arrival_bucket == bucket) {
+                top.arrival_bid = book.arrival_bid;
+                top.arrival_ask = book.arrival_ask;
+            }
+            return top;
+        }
+
+        // Prefetching ahead of a batch of messages: an order's slot, and the level a new order
+        // will join
+        void prefetch(uint64_t order_id) const { orders_.prefetch(order_id); }
+
+        void prefetchLevel(uint16_t stock_id, char side, uint32_t price) const {
+            if (stock_id >= books_.size()) return;
+            const Book& book = books_[stock_id];
+            (side == 'S' ? book.asks : book.bids).prefetch(price);
+        }
+
+        const BookSide* bids(uint16_t stock_id) const { return stock_id < books_.size() ? &books_[stock_id].bids : nullptr; }
+        const BookSide* asks(uint16_t stock_id) const { return stock_id < books_.size() ? &books_[stock_id].asks : nullptr; }
+        size_t orders() const { return orders_.size(); }
+
+        // Checkpoint image, see Checkpoint.h: the live orders and each stock's arrival quote.
+        // The price levels are rebuilt from the orders on load.
+        template<typename Out>
+        void save(Out& out) const {
+            orders_.save(out);
+            std::vector<Arrival> arrivals(books_.size());
+            for (size_t i = 0; i < books_.size(); ++i) {
+                arrivals[i] = { books_[i].arrival_bucket, books_[i].arrival_bid, books_[i].arrival_ask };
+            }
+            out.putVector(arrivals);
+        }
+
+        template<typename In>
+        void load(In& in) {
+            orders_.load(in);
+            std::vector<Arrival> arrivals;
+            in.getVector(arrivals);
+            books_.clear();
+            orders_.forEach([this](const BookOrder& order) {
+                if (BookSide* levels = sideOf(order)) levels->add(order.price, order.shares);
+            });
+            for (size_t i = 0; i < arrivals.size(); ++i) {
+                Book& book = bookOf(static_cast<uint16_t>(i));
+                book.arrival_bucket = arrivals[i].bucket;
+                book.arrival_bid = arrivals[i].bid;
+                book.arrival_ask = arrivals[i].ask;
+            }
+        }
+
+    private:
+        struct Book {
+            BookSide bids{ true };
+            BookSide asks{ false };
+            uint32_t arrival_bucket = UINT32_MAX;
+            uint32_t arrival_bid = 0;
+            uint32_t arrival_ask = 0;
+        };
+
+        struct Arrival {
+            uint32_t bucket;
+            uint32_t bid;
+            uint32_t ask;
+        };
+
+        Book& bookOf(uint16_t stock_id) {
+            if (stock_id >= books_.size()) books_.resize(static_cast<size_t>(stock_id) + 1);
+            return books_[stock_id];
+        }
+
+        // nullptr for an order kept off the levels
+        BookSide* sideOf(uint16_t stock_id, char side) {
+            if (side == 0) return nullptr;
+            Book& book = bookOf(stock_id);
+            return side == 'S' ? &book.asks : &book.bids;
+        }
+
+        BookSide* sideOf(const BookOrder& order) { return sideOf(order.stock_id, order.side); }
+
+        BasicOrderTable<BookOrder> orders_;
+        std::vector<Book> books_;
+    };
+
+    namespace detail {
+        // (bid + ask) / 2 in dollars, 4 decimals like the VWAP
+        inline char* appendMid(char* out, uint32_t bid, uint32_t ask) {
+            uint64_t twice = static_cast<uint64_t>(bid) + ask;
+            return std::to_chars(out, out + 32, twice / 20000.0, std::chars_format::fixed, 4).ptr;
+        }
+    }
+
+    // ",MID,SPREAD,BID_SIZE,ASK_SIZE,ARRIVAL_MID"; MID and SPREAD are empty unless both sides
+    // are quoted
+    constexpr std::string_view kBookColumns = ",MID,SPREAD,BID_SIZE,ASK_SIZE,ARRIVAL_MID";
+    constexpr size_t kMaxBookQuoteSize = 5 * 24;
+
+    // What a VwapRow carries of the book: nothing in a build without -DGUG_WITH_BOOK
+    struct NoBookQuote {
+        NoBookQuote() = default;
+        NoBookQuote(const BookQuote&) {}
+    };
+    using RowBookQuote = std::conditional_t<kBookEnabled, BookQuote, NoBookQuote>;
+
+    inline char* formatBookQuote(char* out, const BookQuote& quote) {
+        *out++ = ',';
+        bool quoted = quote.bid != 0 && quote.ask != 0;
+        if (quoted) out = detail::appendMid(out, quote.bid, quote.ask);
+        *out++ = ',';
+        if (quoted) {
+            int64_t spread = static_cast<int64_t>(quote.ask) - static_cast<int64_t>(quote.bid);
+            out = std::to_chars(out, out + 24, spread / 10000.0, std::chars_format::fixed, 4).ptr;
+        }
+        *out++ = ',';
+        out = std::to_chars(out, out + 20, quote.bid_shares).ptr;
+        *out++ = ',';
+        out = std::to_chars(out, out + 20, quote.ask_shares).ptr;
+        *out++ = ',';
+        if (quote.arrival_bid != 0 && quote.arrival_ask != 0) out = detail::appendMid(out, quote.arrival_bid, quote.arrival_ask);
+        return out;
+    }
+
+    inline char* formatBookQuote(char* out, const NoBookQuote&) { return out; }
+}
+
+#endif
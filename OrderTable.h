@@ -0,0 +1,212 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 10:21:37
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 22:06:15
+ */
+
+#ifndef ORDER_TABLE_H
+#define ORDER_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace GuG {
+
+    struct OrderEntry {
+        uint64_t order_id;  // 0 marks an empty slot
+        uint32_t price;
+        uint32_t shares;    // remaining shares
+    };
+    static_assert(sizeof(OrderEntry) == 16, "OrderEntry should stay one quarter of a cache line");
+
+    // Live orders keyed by order reference number.
+    // Open addressing with linear probing over a flat power-of-two array; erase shifts the
+    // following entries back instead of leaving tombstones, so the table only holds live
+    // orders and probe chains stay short for the whole day.
+    // Entry starts with order_id, price and shares; OrderBook.h keeps larger entries.
+    template<typename Entry>
+    class BasicOrderTable {
+    public:
+        explicit BasicOrderTable(size_t expected_orders = 1u << 20) {
+            reserve(expected_orders);
+        }
+
+        // Sizes the table for expected_orders live orders at a load factor of at most 1/2
+        void reserve(size_t expected_orders) {
+            size_t capacity = 16;
+            while (capacity < expected_orders * 2) capacity <<= 1;
+            if (capacity > slots_.size()) rehash(capacity);
+        }
+
+        void insert(uint64_t order_id, uint32_t price, uint32_t shares) {
+            insert(Entry{ order_id, price, shares });
+        }
+
+        // An order already in the table is replaced
+        void insert(const Entry& entry) {
+            if (entry.order_id == 0) {
+                zero_order_ = entry;
+                has_zero_order_ = true;
+                return;
+            }
+            if ((size_ + 1) * 2 > slots_.size()) rehash(slots_.size() * 2);
+            size_t i = slotOf(entry.order_id);
+            while (slots_[i].order_id != 0) {
+                if (slots_[i].order_id == entry.order_id) {
+                    slots_[i] = entry;
+                    return;
+                }
+                i = (i + 1) & mask_;
+            }
+            slots_[i] = entry;
+            ++size_;
+        }
+
+        const Entry* find(uint64_t order_id) const {
+            if (order_id == 0) return has_zero_order_ ? &zero_order_ : nullptr;
+            size_t i = slotOf(order_id);
+            while (slots_[i].order_id != 0) {
+                if (slots_[i].order_id == order_id) return &slots_[i];
+                i = (i + 1) & mask_;
+            }
+            return nullptr;
+        }
+
+        // Valid until the next insert or erase
+        Entry* find(uint64_t order_id) {
+            return const_cast<Entry*>(static_cast<const BasicOrderTable*>(this)->find(order_id));
+        }
+
+        // Starts loading the order's home slot, where a lookup or insert of it begins
+        void prefetch(uint64_t order_id) const {
+            __builtin_prefetch(&slots_[slotOf(order_id)], 1);
+        }
+
+        bool erase(uint64_t order_id) {
+            if (order_id == 0) {
+                bool had = has_zero_order_;
+                has_zero_order_ = false;
+                return had;
+            }
+            size_t i = slotOf(order_id);
+            while (slots_[i].order_id != order_id) {
+                if (slots_[i].order_id == 0) return false;
+                i = (i + 1) & mask_;
+            }
+            eraseSlot(i);
+            return true;
+        }
+
+        // Takes shares off an order (execution or partial cancel) and drops it once nothing is left.
+        // Returns the order's price, or 0 if the order is unknown.
+        uint32_t reduce(uint64_t order_id, uint32_t shares) {
+            if (order_id == 0) {
+                if (!has_zero_order_) return 0;
+                uint32_t price = zero_order_.price;
+                if (zero_order_.shares <= shares) has_zero_order_ = false;
+                else zero_order_.shares -= shares;
+                return price;
+            }
+            size_t i = slotOf(order_id);
+            while (slots_[i].order_id != order_id) {
+                if (slots_[i].order_id == 0) return 0;
+                i = (i + 1) & mask_;
+            }
+            uint32_t price = slots_[i].price;
+            if (slots_[i].shares <= shares) eraseSlot(i);
+            else slots_[i].shares -= shares;
+            return price;
+        }
+
+        size_t size() const { return size_ + (has_zero_order_ ? 1 : 0); }
+        size_t capacity() const { return slots_.size(); }
+
+        // Calls fn(entry) for every live order, in no particular order
+        template<typename Fn>
+        void forEach(Fn&& fn) const {
+            for (const Entry& entry : slots_) {
+                if (entry.order_id != 0) fn(entry);
+            }
+            if (has_zero_order_) fn(zero_order_);
+        }
+
+        // Checkpoint image, see Checkpoint.h: the capacity and the live orders only
+        template<typename Out>
+        void save(Out& out) const {
+            out.put(static_cast<uint64_t>(slots_.size()));
+            out.put(static_cast<uint64_t>(size()));
+            forEach([&out](const Entry& entry) { out.put(entry); });
+        }
+
+        template<typename In>
+        void load(In& in) {
+            uint64_t capacity = 0;
+            uint64_t orders = 0;
+            in.get(capacity);
+            in.get(orders);
+            if (orders * 2 > capacity || orders > in.left() / sizeof(Entry)) in.fail();
+            slots_.clear();
+            size_ = 0;
+            has_zero_order_ = false;
+            reserve(capacity / 2);
+            for (uint64_t i = 0; i < orders; ++i) {
+                Entry entry;
+                in.get(entry);
+                insert(entry);
+            }
+        }
+
+    private:
+        size_t slotOf(uint64_t order_id) const {
+            // Fibonacci hashing spreads the sequential daily order numbers over the table
+            return (order_id * 0x9E3779B97F4A7C15ULL) >> shift_;
+        }
+
+        // Backward shift deletion: pull later members of the probe chain into the hole
+        void eraseSlot(size_t hole) {
+            size_t i = hole;
+            while (true) {
+                i = (i + 1) & mask_;
+                if (slots_[i].order_id == 0) break;
+                size_t home = slotOf(slots_[i].order_id);
+                // Move the entry if its home slot is not in the cyclic range (hole, i]
+                if (((i - home) & mask_) >= ((i - hole) & mask_)) {
+                    slots_[hole] = slots_[i];
+                    hole = i;
+                }
+            }
+            slots_[hole].order_id = 0;
+            --size_;
+        }
+
+        void rehash(size_t capacity) {
+            std::vector<Entry> old(capacity, Entry{});
+            old.swap(slots_);
+            mask_ = capacity - 1;
+            shift_ = 64 - __builtin_ctzll(capacity);
+            size_ = 0;
+            for (const Entry& entry : old) {
+                if (entry.order_id != 0) {
+                    size_t i = slotOf(entry.order_id);
+                    while (slots_[i].order_id != 0) i = (i + 1) & mask_;
+                    slots_[i] = entry;
+                    ++size_;
+                }
+            }
+        }
+
+        std::vector<Entry> slots_;
+        size_t mask_ = 0;
+        unsigned shift_ = 64;
+        size_t size_ = 0;
+
+        Entry zero_order_{};
+        bool has_zero_order_ = false;
+    };
+
+    using OrderTable = BasicOrderTable<OrderEntry>;
+}
+
+#endif
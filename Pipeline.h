@@ -0,0 +1,753 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 20:41:18
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 22:06:15
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <iostream>
+#include <unordered_map>
+#include <chrono>
+#include <thread>
+#include <array>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <exception>
+#include <cstring>
+
+#include "Message.h"
+#include "ThreadSafeQueue.h"
+#include "SpscRingBuffer.h"
+#include "MemoryMappedFileReader.h"
+#include "StreamReader.h"
+#include "FileBlockReader.h"
+#ifdef GUG_WITH_ZLIB
+#include "GzipReader.h"
+#endif
+#include "OrderTable.h"
+#include "SymbolTable.h"
+#include "FrameParser.h"
+#include "ShardRouter.h"
+#include "VwapOutput.h"
+#include "Options.h"
+#include "Metrics.h"
+#include "Checkpoint.h"
+
+// The stages of the VWAP job, shared by main.cpp and the benchmarks: readDataIntoQueue frames and
+// decodes the input into the shard queues, processMessage aggregates one shard and
+// calcAndOutputVWAP hands a closed bucket to the output; runPipeline wires them to threads.
+namespace GuG {
+
+    // With a checkpointer, a checkpoint is started at the end of a parsed slice or chunk once
+    // one is due, and a resumed run starts at the checkpoint's offset
+    template<typename Queue>
+    void readDataIntoQueue(MemoryMappedFileReader& reader, std::vector<std::unique_ptr<Queue>>& queues, const Options& options, PipelineMetrics& metrics,
+        Checkpointer* checkpointer = nullptr)
+    {
+
+        const std::byte* begin = reinterpret_cast<std::byte*>(reader.data());
+        const std::byte* buffer = begin;
+        const std::byte* end = buffer + reader.size();
+        ShardRouter<Queue> router(queues, options.buckets, metrics);
+        if (checkpointer != nullptr && checkpointer->resuming())
+        {
+            buffer += checkpointer->resumeOffset();
+            router.resumeAt(checkpointer->resumeBucketTime());
+        }
+        auto checkpoint = [&router, checkpointer](uint64_t offset)
+            {
+                if (checkpointer != nullptr && checkpointer->due())
+                {
+                    ItchMessage tick(kCheckpointTick);
+                    tick.stock_id = checkpointer->begin(offset, router.nextBucketTime());
+                    router.broadcast(tick);
+                }
+            };
+        ReaderMetrics& reader_metrics = metrics.reader();
+        auto route = [&router, &reader_metrics](ItchMessageRecord&& message)
+            {
+                reader_metrics.decoded(messageHeader(message).message_type);
+                router.route(std::move(message));
+            };
+        auto on_skip = [&reader_metrics](char message_type) { reader_metrics.skipped(message_type); };
+        const std::uint64_t MB = 1ULL << 20;             // 1 MB in bytes
+        const std::uint64_t update_threshold = 100 * MB; // 100 MB in bytes
+        const MessageFilter filter = makeMessageFilter(options);
+        // mmap-window: RSS stays near read_ahead + 1 slices of the file instead of all of it
+        const bool windowed = options.input_backend == InputBackend::MmapWindow;
+        const size_t prefetch = options.read_ahead * options.read_block;
+        if (windowed)
+        {
+            reader.adviseSequential();
+            reader.release(buffer - begin);
+            reader.prefetch(buffer - begin, prefetch);
+        }
+        if (checkpointer != nullptr && checkpointer->resuming() && filter.symbols())
+        {
+            // the directory entries of the selected stocks are behind the resume offset
+            for (uint16_t locate : checkpointer->resumeLocates())
+            {
+                filter.symbols()->select(locate);
+            }
+        }
+
+        try
+        {
+            if (options.parse_threads > 1)
+            {
+                const size_t start = buffer - begin;
+                size_t byte_read_update = start;
+                size_t byte_read_counted = start;
+                ParallelFrameDecoder decoder(options.parse_threads, filter, options.buckets.width);
+                decoder.run(buffer, end - buffer, route, [&](size_t chunk_end)
+                    {
+                        size_t byte_read = start + chunk_end;
+                        reader_metrics.bytes(byte_read - byte_read_counted);
+                        byte_read_counted = byte_read;
+                        checkpoint(byte_read);
+                        if (windowed)
+                        {
+                            reader.release(byte_read);
+                            reader.prefetch(byte_read, prefetch);
+                        }
+                        if (byte_read - byte_read_update >= update_threshold)
+                        {
+                            std::cout << byte_read / MB << " MB parsed\n";
+                            byte_read_update = byte_read;
+                        }
+                    });
+            }
+            else
+            {
+                // Parse in slices so progress can be reported, and a window released behind them; a
+                // frame cut by the slice end is picked up again by the next slice
+                const size_t slice = windowed ? options.read_block : update_threshold;
+                size_t byte_read_update = buffer - begin;
+                while (buffer < end)
+                {
+                    const std::byte* slice_end = end - buffer > static_cast<ptrdiff_t>(slice) ? buffer + slice : end;
+                    const std::byte* next = parseFrames(buffer, slice_end, route, filter, options.buckets.width, on_skip);
+                    if (next == buffer)
+                    {
+                        break; // only a truncated frame is left
+                    }
+                    reader_metrics.bytes(next - buffer);
+                    buffer = next;
+                    if (windowed)
+                    {
+                        reader.release(buffer - begin);
+                        reader.prefetch(buffer - begin, prefetch);
+                    }
+                    if (buffer < end)
+                    {
+                        checkpoint(buffer - begin);
+                        if (!windowed || static_cast<size_t>(buffer - begin) - byte_read_update >= update_threshold)
+                        {
+                            std::cout << (buffer - begin) / MB << " MB parsed\n";
+                            byte_read_update = buffer - begin;
+                        }
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            // as for the block input: the shards drain what was routed and stop, and runPipeline
+            // reports the error
+            router.finish();
+            throw;
+        }
+        router.finish();
+        std::cout << "Finished Reading Data\n";
+    }
+
+    // Streaming input: frames are parsed as they arrive and partial batches are handed over after
+    // every read. With a live publisher, a publish tick follows new data at most every
+    // options.publish_interval, so snapshots lag the input by about that much.
+    // Streams have no offset to resume from, so they are never checkpointed.
+    template<typename Queue>
+    void readDataIntoQueue(StreamReader& reader, std::vector<std::unique_ptr<Queue>>& queues, const Options& options, PipelineMetrics& metrics,
+        Checkpointer* = nullptr)
+    {
+        ShardRouter<Queue> router(queues, options.buckets, metrics);
+        ReaderMetrics& reader_metrics = metrics.reader();
+        auto route = [&router, &reader_metrics](ItchMessageRecord&& message)
+            {
+                reader_metrics.decoded(messageHeader(message).message_type);
+                router.route(std::move(message));
+            };
+        auto on_skip = [&reader_metrics](char message_type) { reader_metrics.skipped(message_type); };
+        const MessageFilter filter = makeMessageFilter(options);
+        const std::uint64_t MB = 1ULL << 20;             // 1 MB in bytes
+        const std::uint64_t update_threshold = 100 * MB; // 100 MB in bytes
+        const auto publish_interval = std::chrono::nanoseconds(options.publish_interval);
+        const auto max_wait = std::max(std::chrono::duration_cast<std::chrono::milliseconds>(publish_interval), std::chrono::milliseconds(1));
+
+        // a frame is at most 2 + 65535 bytes, so a partial frame always leaves room to read more
+        std::vector<std::byte> buffer(4 * MB);
+        size_t filled = 0u;
+        uint64_t byte_read = 0u;
+        uint64_t byte_read_update = 0u;
+        bool unpublished = false;
+        auto last_publish = std::chrono::steady_clock::now();
+
+        try
+        {
+            while (true)
+            {
+                size_t count = reader.read(buffer.data() + filled, buffer.size() - filled, max_wait);
+                if (count == StreamReader::kEnd)
+                {
+                    break;
+                }
+                filled += count;
+                const std::byte* begin = buffer.data();
+                const std::byte* next = parseFrames(begin, begin + filled, route, filter, options.buckets.width, on_skip);
+                bool end_of_messages = reader.following() && hasEndOfMessages(begin, next);
+                size_t parsed = static_cast<size_t>(next - begin);
+                std::memmove(buffer.data(), next, filled - parsed);
+                filled -= parsed;
+                byte_read += parsed;
+                reader_metrics.bytes(parsed);
+                unpublished |= parsed != 0;
+
+                auto now = std::chrono::steady_clock::now();
+                if (unpublished && now - last_publish >= publish_interval)
+                {
+                    router.broadcast(ItchMessage(kPublishTick));
+                    last_publish = now;
+                    unpublished = false;
+                }
+                router.flush();
+                if (byte_read - byte_read_update >= update_threshold)
+                {
+                    std::cout << byte_read / MB << " MB parsed\n";
+                    byte_read_update = byte_read;
+                }
+                if (end_of_messages)
+                {
+                    break;
+                }
+            }
+        }
+        catch (...)
+        {
+            // a failed poll or read of the stream: the shards drain what was routed and stop,
+            // and runPipeline reports the error
+            router.finish();
+            throw;
+        }
+        router.finish();
+        std::cout << "Finished Reading Data\n";
+    }
+
+    // Readers that hand the feed over as blocks in order: run(consume) calls consume(begin, end)
+    // for each block and passes the bytes it leaves again in front of the next one
+    template<typename Reader>
+    concept BlockInput = requires(Reader& reader)
+    {
+        reader.run([](const std::byte* begin, const std::byte*) { return begin; });
+    };
+
+    // Block input: gzip blocks inflated on background threads, or FileBlockReader blocks read
+    // ahead of the parser; either way each block is parsed in place
+    template<typename Queue, BlockInput Reader>
+    void readDataIntoQueue(Reader& reader, std::vector<std::unique_ptr<Queue>>& queues, const Options& options, PipelineMetrics& metrics,
+        Checkpointer* = nullptr)
+    {
+        ShardRouter<Queue> router(queues, options.buckets, metrics);
+        ReaderMetrics& reader_metrics = metrics.reader();
+        auto route = [&router, &reader_metrics](ItchMessageRecord&& message)
+            {
+                reader_metrics.decoded(messageHeader(message).message_type);
+                router.route(std::move(message));
+            };
+        auto on_skip = [&reader_metrics](char message_type) { reader_metrics.skipped(message_type); };
+        const MessageFilter filter = makeMessageFilter(options);
+        const std::uint64_t MB = 1ULL << 20;             // 1 MB in bytes
+        const std::uint64_t update_threshold = 100 * MB; // 100 MB in bytes
+        uint64_t byte_read = 0u;
+        uint64_t byte_read_update = 0u;
+
+        try
+        {
+            reader.run([&](const std::byte* begin, const std::byte* end)
+                {
+                    const std::byte* next = parseFrames(begin, end, route, filter, options.buckets.width, on_skip);
+                    byte_read += next - begin;
+                    reader_metrics.bytes(next - begin);
+                    if (byte_read - byte_read_update >= update_threshold)
+                    {
+                        std::cout << byte_read / MB << " MB parsed\n";
+                        byte_read_update = byte_read;
+                    }
+                    return next;
+                });
+        }
+        catch (...)
+        {
+            // a corrupt archive or a failed read: the shards still drain what was routed and
+            // stop, and runPipeline reports the error
+            router.finish();
+            throw;
+        }
+        router.finish();
+        std::cout << "Finished Reading Data\n";
+    }
+
+    // With bar metrics or the order book, state is the shard's state for their columns and
+    // bucket_end is the end of the bucket
+    void calcAndOutputVWAP(uint32_t bucket, SymbolTable& symbol_table, BucketMerger& merger,
+        const ShardState* state = nullptr, uint64_t bucket_end = 0)
+    {
+        std::vector<VwapRow> rows;
+        symbol_table.closeBucket(bucket, [&](uint16_t stock_id, const VolumeAccumulator& in_bucket, const VolumeAccumulator& in_window)
+            {
+                rows.push_back({ symbol_table.symbol(stock_id), stock_id, bucket,
+                    in_bucket.volume, in_bucket.notional, in_window.volume, in_window.notional });
+                if constexpr (kBarsEnabled)
+                {
+                    if (state != nullptr)
+                    {
+                        rows.back().bar = state->bar_table.bar(stock_id, bucket, bucket_end);
+                    }
+                }
+                if constexpr (kBookEnabled)
+                {
+                    if (state != nullptr)
+                    {
+                        rows.back().book = state->order_book.quote(stock_id, bucket);
+                    }
+                }
+            });
+        merger.submit(bucket, std::move(rows));
+    }
+
+    // Starts loading the table slots processMessage will touch for message: the order's slot
+    // for order messages, the stock's accumulators for trades and the journal entry of a break.
+    // Only addresses are computed, nothing is read that the message's own update depends on.
+    inline void prefetchMessage(const ItchMessageRecord& message, const ShardState& state)
+    {
+        auto prefetch_order = [&state](uint64_t order_id)
+            {
+                if constexpr (kBookEnabled)
+                {
+                    state.order_book.prefetch(order_id);
+                }
+                else
+                {
+                    state.order_table.prefetch(order_id);
+                }
+            };
+        switch (messageHeader(message).message_type)
+        {
+        case 'A':
+        {
+            const auto& msg = std::get<AddOrderMessage>(message);
+            prefetch_order(msg.order_id);
+            if constexpr (kBookEnabled)
+            {
+                state.order_book.prefetchLevel(msg.stock_id, msg.side, msg.price);
+            }
+            break;
+        }
+        case 'F':
+        {
+            const auto& msg = std::get<AddOrderMPIDAttributionMessage>(message);
+            prefetch_order(msg.order_id);
+            if constexpr (kBookEnabled)
+            {
+                state.order_book.prefetchLevel(msg.stock_id, msg.side, msg.price);
+            }
+            break;
+        }
+        case 'E':
+        {
+            const auto& msg = std::get<OrderExecutedMessage>(message);
+            prefetch_order(msg.order_id);
+            state.symbol_table.prefetch(msg.stock_id);
+            break;
+        }
+        case 'C':
+        {
+            const auto& msg = std::get<OrderExecutedWithPriceMessage>(message);
+            prefetch_order(msg.order_id);
+            state.symbol_table.prefetch(msg.stock_id);
+            break;
+        }
+        case 'U':
+        {
+            const auto& msg = std::get<OrderReplaceMessage>(message);
+            prefetch_order(msg.original_order_id);
+            prefetch_order(msg.new_order_id);
+            break;
+        }
+        case 'X':
+            prefetch_order(std::get<OrderCancelMessage>(message).order_id);
+            break;
+        case 'D':
+            prefetch_order(std::get<OrderDeleteMessage>(message).order_id);
+            break;
+        case 'P':
+            state.symbol_table.prefetch(std::get<NonCrossTradeMessage>(message).stock_id);
+            break;
+        case 'Q':
+            state.symbol_table.prefetch(std::get<CrossTradeMessage>(message).stock_id);
+            break;
+        case 'B':
+            state.match_journal.prefetch(std::get<BrokenTradeMessage>(message).match_number);
+            break;
+        default:
+            break;
+        }
+    }
+
+    template<typename Queue>
+    void processMessage(Queue& queue, const Options& options, BucketMerger& merger, LivePublisher* publisher, ShardMetrics& metrics,
+        Checkpointer* checkpointer = nullptr, size_t shard = 0)
+    {
+        std::array<ItchMessageRecord, kQueueBatchSize> batch;
+        const TimeBuckets& buckets = options.buckets;
+        ShardState state = checkpointer != nullptr ? checkpointer->takeState(shard, options) : ShardState(options);
+        SymbolTable& symbol_table = state.symbol_table;
+        OrderTable& order_table = state.order_table;
+        TradeJournal& trade_journal = state.match_journal;
+        TradeBarTable& bar_table = state.bar_table;
+        OrderBook& order_book = state.order_book;
+        uint32_t& cur_bucket = state.cur_bucket;
+        uint64_t& next_bucket_time = state.next_bucket_time;
+        uint64_t snapshot = 0u;
+        // Messages are applied in feed order, with the slots of the next prefetch_batch messages
+        // of the popped batch already requested, so their cache misses overlap
+        const size_t prefetch_batch = std::min(options.prefetch_batch, batch.size());
+
+        // popBatch blocks until messages arrive and only returns 0 once the reader has finished
+        while (size_t batch_size = queue.popBatch(batch.data(), batch.size()))
+        {
+            const uint64_t popped = metrics.batchStart();
+            for (size_t i = 0; i < std::min(prefetch_batch, batch_size); ++i)
+            {
+                prefetchMessage(batch[i], state);
+            }
+            for (size_t i = 0; i < batch_size; ++i)
+            {
+                if (prefetch_batch != 0 && i + prefetch_batch < batch_size)
+                {
+                    prefetchMessage(batch[i + prefetch_batch], state);
+                }
+                const ItchMessageRecord& message = batch[i];
+                const ItchMessage& header = messageHeader(message);
+                char message_type = header.message_type;
+                if constexpr (kMetricsEnabled)
+                {
+                    if (message_type == kLatencyProbe)
+                    {
+                        metrics.probe(popped, header.message_time);
+                        continue;
+                    }
+                }
+
+                if (header.message_time >= next_bucket_time)
+                { // leave time for fixing broken message
+                    uint32_t msg_bucket = buckets.index(header.message_time);
+                    while (cur_bucket < msg_bucket)
+                    {
+                        calcAndOutputVWAP(cur_bucket, symbol_table, merger, &state, buckets.start(cur_bucket + 1));
+                        ++cur_bucket;
+                    }
+                    next_bucket_time = buckets.start(cur_bucket + 1);
+                }
+                switch (message_type)
+                {
+                case 'R':
+                {
+                    auto casted_msg = &std::get<StockDirectoryMessage>(message);
+                    symbol_table.addStock(casted_msg->stock_id, casted_msg->stock_symbol);
+                    bar_table.clear(casted_msg->stock_id);
+                    break;
+                }
+                case 'A':
+                {
+                    auto casted_msg = &std::get<AddOrderMessage>(message);
+                    if constexpr (kBookEnabled)
+                    {
+                        order_book.add(casted_msg->stock_id, casted_msg->order_id, casted_msg->side, casted_msg->price, casted_msg->shares);
+                    }
+                    else
+                    {
+                        order_table.insert(casted_msg->order_id, casted_msg->price, casted_msg->shares);
+                    }
+                    break;
+                }
+                case 'F':
+                {
+                    auto casted_msg = &std::get<AddOrderMPIDAttributionMessage>(message);
+                    if constexpr (kBookEnabled)
+                    {
+                        order_book.add(casted_msg->stock_id, casted_msg->order_id, casted_msg->side, casted_msg->price,
+                            static_cast<uint32_t>(casted_msg->shares));
+                    }
+                    else
+                    {
+                        order_table.insert(casted_msg->order_id, casted_msg->price, static_cast<uint32_t>(casted_msg->shares));
+                    }
+                    break;
+                }
+                case 'E':
+                { // Actual Trade
+                    auto casted_msg = &std::get<OrderExecutedMessage>(message);
+                    uint32_t cur_volume = casted_msg->executed_shares;
+                    // unknown orders trade at price 0, fully executed orders leave the table
+                    uint32_t cur_price = 0;
+                    if constexpr (kBookEnabled)
+                    {
+                        order_book.arrive(casted_msg->stock_id, cur_bucket);
+                        cur_price = order_book.reduce(casted_msg->order_id, cur_volume);
+                    }
+                    else
+                    {
+                        cur_price = order_table.reduce(casted_msg->order_id, cur_volume);
+                    }
+                    if (cur_price == 0)
+                    {
+                        metrics.unmatchedOrder();
+                    }
+
+                    trade_journal.record(casted_msg->match_number, casted_msg->stock_id, cur_price, cur_volume, cur_bucket);
+                    symbol_table.addTrade(casted_msg->stock_id, cur_bucket, cur_price, cur_volume);
+                    bar_table.add(casted_msg->stock_id, cur_bucket, header.message_time, cur_price, cur_volume);
+                    break;
+                }
+                case 'C':
+                {
+                    auto casted_msg = &std::get<OrderExecutedWithPriceMessage>(message);
+                    uint32_t order_price = 0;
+                    if constexpr (kBookEnabled)
+                    {
+                        if (casted_msg->printable != 'N')
+                        {
+                            order_book.arrive(casted_msg->stock_id, cur_bucket);
+                        }
+                        order_price = order_book.reduce(casted_msg->order_id, casted_msg->executed_shares);
+                    }
+                    else
+                    {
+                        order_price = order_table.reduce(casted_msg->order_id, casted_msg->executed_shares);
+                    }
+                    if (order_price == 0)
+                    {
+                        metrics.unmatchedOrder();
+                    }
+                    if (casted_msg->printable == 'N')
+                    {
+                        // Only count Printable
+                        continue;
+                    }
+                    uint32_t cur_price = casted_msg->execution_price;
+                    uint32_t cur_volume = casted_msg->executed_shares;
+
+                    trade_journal.record(casted_msg->match_number, casted_msg->stock_id, cur_price, cur_volume, cur_bucket);
+                    symbol_table.addTrade(casted_msg->stock_id, cur_bucket, cur_price, cur_volume);
+                    bar_table.add(casted_msg->stock_id, cur_bucket, header.message_time, cur_price, cur_volume);
+                    break;
+                }
+                case 'U':
+                {
+                    auto casted_msg = &std::get<OrderReplaceMessage>(message);
+                    bool known = false;
+                    if constexpr (kBookEnabled)
+                    {
+                        known = order_book.replace(casted_msg->stock_id, casted_msg->original_order_id, casted_msg->new_order_id,
+                            casted_msg->price, casted_msg->shares);
+                    }
+                    else
+                    {
+                        known = order_table.erase(casted_msg->original_order_id);
+                        order_table.insert(casted_msg->new_order_id, casted_msg->price, casted_msg->shares);
+                    }
+                    if (!known)
+                    {
+                        metrics.unmatchedOrder();
+                    }
+                    break;
+                }
+                case 'X':
+                {
+                    auto casted_msg = &std::get<OrderCancelMessage>(message);
+                    uint32_t order_price = 0;
+                    if constexpr (kBookEnabled)
+                    {
+                        order_price = order_book.reduce(casted_msg->order_id, casted_msg->cancelled_shares);
+                    }
+                    else
+                    {
+                        order_price = order_table.reduce(casted_msg->order_id, casted_msg->cancelled_shares);
+                    }
+                    if (order_price == 0)
+                    {
+                        metrics.unmatchedOrder();
+                    }
+                    break;
+                }
+                case 'D':
+                {
+                    auto casted_msg = &std::get<OrderDeleteMessage>(message);
+                    bool known = false;
+                    if constexpr (kBookEnabled)
+                    {
+                        known = order_book.erase(casted_msg->order_id);
+                    }
+                    else
+                    {
+                        known = order_table.erase(casted_msg->order_id);
+                    }
+                    if (!known)
+                    {
+                        metrics.unmatchedOrder();
+                    }
+                    break;
+                }
+                case 'P':
+                {
+                    auto casted_msg = &std::get<NonCrossTradeMessage>(message);
+                    if constexpr (kBookEnabled)
+                    {
+                        order_book.arrive(casted_msg->stock_id, cur_bucket);
+                    }
+                    uint32_t cur_price = casted_msg->price;
+                    uint32_t cur_volume = casted_msg->shares;
+
+                    trade_journal.record(casted_msg->match_number, casted_msg->stock_id, cur_price, cur_volume, cur_bucket);
+                    symbol_table.addTrade(casted_msg->stock_id, cur_bucket, cur_price, cur_volume);
+                    bar_table.add(casted_msg->stock_id, cur_bucket, header.message_time, cur_price, cur_volume);
+                    break;
+                }
+                case 'Q':
+                {
+                    auto casted_msg = &std::get<CrossTradeMessage>(message);
+                    if constexpr (kBookEnabled)
+                    {
+                        order_book.arrive(casted_msg->stock_id, cur_bucket);
+                    }
+                    uint32_t cur_price = casted_msg->cross_price;
+                    uint64_t cur_volume = casted_msg->shares;
+
+                    trade_journal.record(casted_msg->match_number, casted_msg->stock_id, cur_price, cur_volume, cur_bucket);
+                    symbol_table.addTrade(casted_msg->stock_id, cur_bucket, cur_price, cur_volume);
+                    bar_table.add(casted_msg->stock_id, cur_bucket, header.message_time, cur_price, cur_volume);
+                    break;
+                }
+                case 'B':
+                {
+                    auto casted_msg = &std::get<BrokenTradeMessage>(message);
+                    const TradeEntry* trade = trade_journal.find(casted_msg->match_number);
+                    if (trade == nullptr)
+                    {
+                        metrics.unmatchedBreak();
+                        continue;
+                    }
+                    symbol_table.removeTrade(trade->stock_id, trade->bucket, trade->price, trade->volume());
+                    bar_table.remove(trade->stock_id, trade->bucket, trade->price, trade->volume());
+                    trade_journal.erase(casted_msg->match_number);
+                    break;
+                }
+                case kPublishTick:
+                {
+                    std::vector<VwapRow> rows;
+                    symbol_table.snapshot(cur_bucket, [&](uint16_t stock_id, const VolumeAccumulator& in_bucket, const VolumeAccumulator& in_window)
+                        {
+                            rows.push_back({ symbol_table.symbol(stock_id), stock_id, cur_bucket,
+                                in_bucket.volume, in_bucket.notional, in_window.volume, in_window.notional,
+                                bar_table.bar(stock_id, cur_bucket, 0) });
+                            if constexpr (kBookEnabled)
+                            {
+                                rows.back().book = order_book.quote(stock_id, cur_bucket);
+                            }
+                        });
+                    publisher->submit(snapshot++, std::move(rows));
+                    break;
+                }
+                case kCheckpointTick:
+                {
+                    checkpointer->submit(header.stock_id, shard, state);
+                    break;
+                }
+                default:
+                    continue;
+                }
+            }
+            metrics.batchEnd(popped, batch_size);
+            metrics.tableSizes(kBookEnabled ? order_book.orders() : order_table.size(), trade_journal.size());
+        }
+        while (cur_bucket < buckets.perDay())
+        {
+            calcAndOutputVWAP(cur_bucket, symbol_table, merger, &state, buckets.start(cur_bucket + 1));
+            ++cur_bucket;
+        }
+    }
+
+    // One reader thread feeding options.threads processor shards, each with its own queue.
+    // An error of the reader (a corrupt archive, a failed read) is rethrown here once every
+    // shard has processed what was read before it.
+    template<typename Queue, typename Input, typename... QueueArgs>
+    void runPipeline(Input& input, const Options& options, AsyncVwapWriter& writer, PipelineMetrics& metrics, LivePublisher* publisher,
+        Checkpointer* checkpointer, QueueArgs... queue_args)
+    {
+        std::vector<std::unique_ptr<Queue>> queues;
+        for (size_t i = 0; i < options.threads; ++i)
+        {
+            queues.push_back(std::make_unique<Queue>(queue_args...));
+        }
+        BucketMerger merger(options.threads, options.buckets, writer);
+
+        std::exception_ptr reader_error;
+        std::thread reader_thread([&]()
+            {
+                try
+                {
+                    readDataIntoQueue(input, queues, options, metrics, checkpointer);
+                }
+                catch (...)
+                {
+                    reader_error = std::current_exception();
+                }
+            });
+        std::vector<std::thread> process_threads;
+        for (size_t i = 0; i < queues.size(); ++i)
+        {
+            process_threads.emplace_back(processMessage<Queue>, std::ref(*queues[i]), std::cref(options), std::ref(merger), publisher,
+                std::ref(metrics.shard(i)), checkpointer, i);
+        }
+        std::cout << "VWAP Job Finished \n";
+        // Join threads
+        reader_thread.join();
+        for (auto& process_thread : process_threads)
+        {
+            process_thread.join();
+        }
+        if (reader_error)
+        {
+            std::rethrow_exception(reader_error);
+        }
+    }
+
+    template<typename Input>
+    void runPipeline(Input& input, const Options& options, AsyncVwapWriter& writer, PipelineMetrics& metrics, LivePublisher* publisher = nullptr,
+        Checkpointer* checkpointer = nullptr)
+    {
+        if (options.queue_kind == QueueKind::Spsc)
+        {
+            runPipeline<SpscRingBuffer<ItchMessageRecord>>(input, options, writer, metrics, publisher, checkpointer, options.queue_capacity);
+        }
+        else
+        {
+            runPipeline<ThreadSafeQueue<ItchMessageRecord>>(input, options, writer, metrics, publisher, checkpointer);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 11:48:53
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 22:06:15
+ */
+
+#ifndef SHARD_ROUTER_H
+#define SHARD_ROUTER_H
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "Message.h"
+#include "TimeBuckets.h"
+#include "Metrics.h"
+#include "SpscRingBuffer.h"
+
+namespace GuG {
+
+    // Reader side of the processor queues. Every message goes to the shard that owns its
+    // stock locate, so each shard sees its symbols in feed order and never shares state.
+    // With more than one shard, the first message of a new bucket is preceded by a tick
+    // (a bare ItchMessage with message_type '\0') on every shard, so all shards close a bucket
+    // at the same point of the feed as a single processor would.
+    // Metrics builds end every batch with a latency probe and track the depth of every queue.
+    template<typename Queue>
+    class ShardRouter {
+    public:
+        ShardRouter(std::vector<std::unique_ptr<Queue>>& queues, const TimeBuckets& buckets, PipelineMetrics& metrics)
+            : queues_(queues), buckets_(buckets), metrics_(metrics), batches_(queues.size()), batch_sizes_(queues.size(), 0u),
+            next_bucket_time_(buckets.width) {}
+
+        void route(ItchMessageRecord&& record) {
+            const ItchMessage& header = messageHeader(record);
+            size_t shard = header.stock_id % queues_.size();
+            if (queues_.size() > 1 && header.message_time >= next_bucket_time_) {
+                next_bucket_time_ = buckets_.start(buckets_.index(header.message_time) + 1);
+                ItchMessage tick(kBucketTick);
+                tick.message_time = header.message_time;
+                broadcast(tick);
+            }
+            if (queues_.size() > 1 && header.message_type == kBucketTick) {
+                return;  // ticks from the parser have been broadcast above
+            }
+            append(shard, std::move(record));
+        }
+
+        // Sends a control record to every shard
+        void broadcast(const ItchMessageRecord& record) {
+            for (size_t i = 0; i < queues_.size(); ++i) {
+                append(i, ItchMessageRecord(record));
+            }
+        }
+
+        // Bucket tick state, saved with checkpoints
+        uint64_t nextBucketTime() const { return next_bucket_time_; }
+        void resumeAt(uint64_t next_bucket_time) { next_bucket_time_ = next_bucket_time; }
+
+        // Hands partial batches to the shards, so messages of a slow stream are not held back
+        void flush() {
+            for (size_t i = 0; i < queues_.size(); ++i) {
+                if (batch_sizes_[i] != 0) {
+                    push(i);
+                }
+            }
+        }
+
+        // Flushes partial batches and tells every shard the feed is over
+        void finish() {
+            for (size_t i = 0; i < queues_.size(); ++i) {
+                push(i);
+                queues_[i]->finish();
+            }
+        }
+
+    private:
+        // Room is left for the probe in metrics builds
+        static constexpr size_t kBatchMessages = kQueueBatchSize - (kMetricsEnabled ? 1 : 0);
+
+        void append(size_t shard, ItchMessageRecord&& record) {
+            batches_[shard][batch_sizes_[shard]] = std::move(record);
+            if (++batch_sizes_[shard] == kBatchMessages) {
+                push(shard);
+            }
+        }
+
+        void push(size_t shard) {
+            auto& batch = batches_[shard];
+            size_t& batch_size = batch_sizes_[shard];
+            if constexpr (kMetricsEnabled) {
+                ItchMessage probe(kLatencyProbe);
+                probe.message_time = readCycles();
+                batch[batch_size++] = probe;
+            }
+            queues_[shard]->pushBatch(batch.data(), batch_size);
+            batch_size = 0u;
+            if constexpr (kMetricsEnabled) {
+                metrics_.shard(shard).queueDepth(queues_[shard]->size());
+            }
+        }
+
+        std::vector<std::unique_ptr<Queue>>& queues_;
+        const TimeBuckets buckets_;
+        PipelineMetrics& metrics_;
+        std::vector<std::array<ItchMessageRecord, kQueueBatchSize>> batches_;
+        std::vector<size_t> batch_sizes_;
+        uint64_t next_bucket_time_;  // start of the bucket after the newest routed message
+    };
+}
+
+#endif
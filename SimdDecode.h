@@ -0,0 +1,138 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 14:03:51
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 14:03:51
+ */
+
+#ifndef SIMD_DECODE_H
+#define SIMD_DECODE_H
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GUG_X86_SIMD 1
+#endif
+
+namespace GuG {
+
+    // Vectorised byte swapping for whole message bodies.
+    // A message body (everything after the type byte, at most 48 bytes) is loaded with full-width
+    // vector loads, every big-endian field is reversed by a few pshufb/vpshufb operations and the
+    // result is stored to a 64-byte staging buffer, where all fields read as native values.
+
+    constexpr size_t kSwapBlockSize = 16;
+    constexpr size_t kSwapBlocks = 4;
+    constexpr size_t kSwapStagingSize = kSwapBlockSize * kSwapBlocks;
+    constexpr size_t kMaxSwappedBody = 48;  // the SSSE3 kernel swaps the first three blocks
+
+    // A big-endian field of a message body: offset after the type byte and width in bytes
+    struct FieldSpan {
+        uint8_t offset;
+        uint8_t width;
+    };
+
+    // Fields are at most 8 bytes wide, so a byte of output block b comes from source block
+    // b - 1, b or b + 1. masks[k][b] is the pshufb control taking bytes from block b - 1 + k;
+    // 0x80 entries produce zero so the three shuffles can be OR-ed together.
+    struct ByteSwapMasks {
+        alignas(32) uint8_t masks[3][kSwapBlocks][kSwapBlockSize];
+    };
+
+    template<size_t N>
+    constexpr ByteSwapMasks makeByteSwapMasks(const FieldSpan(&fields)[N]) {
+        uint8_t source[kSwapStagingSize] = {};
+        for (size_t i = 0; i < kSwapStagingSize; ++i) source[i] = static_cast<uint8_t>(i);
+        for (const FieldSpan& field : fields) {
+            for (size_t j = 0; j < field.width; ++j) {
+                source[field.offset + j] = static_cast<uint8_t>(field.offset + field.width - 1 - j);
+            }
+        }
+        ByteSwapMasks result{};
+        for (size_t k = 0; k < 3; ++k)
+            for (size_t b = 0; b < kSwapBlocks; ++b)
+                for (size_t i = 0; i < kSwapBlockSize; ++i)
+                    result.masks[k][b][i] = 0x80;
+        for (size_t b = 0; b < kSwapBlocks; ++b) {
+            for (size_t i = 0; i < kSwapBlockSize; ++i) {
+                size_t from = source[b * kSwapBlockSize + i];
+                size_t k = from / kSwapBlockSize + 1 - b;
+                result.masks[k][b][i] = static_cast<uint8_t>(from % kSwapBlockSize);
+            }
+        }
+        return result;
+    }
+
+    enum class SimdLevel {
+        Scalar,
+        Ssse3,
+        Avx2
+    };
+
+    inline const char* simdLevelName(SimdLevel level) {
+        switch (level) {
+        case SimdLevel::Avx2: return "avx2";
+        case SimdLevel::Ssse3: return "ssse3";
+        default: return "scalar";
+        }
+    }
+
+    inline SimdLevel detectSimdLevel() {
+#ifdef GUG_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+        if (__builtin_cpu_supports("ssse3")) return SimdLevel::Ssse3;
+#endif
+        return SimdLevel::Scalar;
+    }
+
+#ifdef GUG_X86_SIMD
+    __attribute__((target("ssse3"), always_inline))
+    inline void swapFieldsSsse3(const std::byte* source, std::byte* staging, const ByteSwapMasks& m) {
+#define GUG_SWAP_MASK(k, b) _mm_load_si128(reinterpret_cast<const __m128i*>(m.masks[k][b]))
+        const __m128i* from = reinterpret_cast<const __m128i*>(source);
+        __m128i* block = reinterpret_cast<__m128i*>(staging);
+        __m128i s0 = _mm_loadu_si128(from);
+        __m128i s1 = _mm_loadu_si128(from + 1);
+        __m128i s2 = _mm_loadu_si128(from + 2);
+        __m128i d0 = _mm_or_si128(_mm_shuffle_epi8(s0, GUG_SWAP_MASK(1, 0)), _mm_shuffle_epi8(s1, GUG_SWAP_MASK(2, 0)));
+        __m128i d1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(s0, GUG_SWAP_MASK(0, 1)), _mm_shuffle_epi8(s1, GUG_SWAP_MASK(1, 1))),
+            _mm_shuffle_epi8(s2, GUG_SWAP_MASK(2, 1)));
+        __m128i d2 = _mm_or_si128(_mm_shuffle_epi8(s1, GUG_SWAP_MASK(0, 2)), _mm_shuffle_epi8(s2, GUG_SWAP_MASK(1, 2)));
+#undef GUG_SWAP_MASK
+        _mm_store_si128(block, d0);
+        _mm_store_si128(block + 1, d1);
+        _mm_store_si128(block + 2, d2);
+    }
+
+    __attribute__((target("avx2"), always_inline))
+    inline void swapFieldsAvx2(const std::byte* source, std::byte* staging, const ByteSwapMasks& m) {
+#define GUG_SWAP_MASK(k, b) _mm256_load_si256(reinterpret_cast<const __m256i*>(m.masks[k][b]))
+        const __m256i* from = reinterpret_cast<const __m256i*>(source);
+        __m256i* half = reinterpret_cast<__m256i*>(staging);
+        __m256i y0 = _mm256_loadu_si256(from);                        // blocks 0, 1
+        __m256i y1 = _mm256_loadu_si256(from + 1);                    // blocks 2, 3
+        __m256i before0 = _mm256_permute2x128_si256(y0, y0, 0x08);    // blocks -, 0
+        __m256i middle = _mm256_permute2x128_si256(y0, y1, 0x21);     // blocks 1, 2
+        __m256i after1 = _mm256_permute2x128_si256(y1, y1, 0x81);     // blocks 3, -
+        __m256i d0 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(before0, GUG_SWAP_MASK(0, 0)),
+            _mm256_shuffle_epi8(y0, GUG_SWAP_MASK(1, 0))), _mm256_shuffle_epi8(middle, GUG_SWAP_MASK(2, 0)));
+        __m256i d1 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(middle, GUG_SWAP_MASK(0, 2)),
+            _mm256_shuffle_epi8(y1, GUG_SWAP_MASK(1, 2))), _mm256_shuffle_epi8(after1, GUG_SWAP_MASK(2, 2)));
+#undef GUG_SWAP_MASK
+        _mm256_store_si256(half, d0);
+        _mm256_store_si256(half + 1, d1);
+    }
+#endif
+
+    // True if the kernels may load a whole staging buffer starting at data: the bytes past the
+    // message are never used, but the load must not cross into a page that may be unmapped
+    inline bool canOverreadStaging(const std::byte* data) {
+        constexpr uintptr_t kPageSize = 4096;
+        return (reinterpret_cast<uintptr_t>(data) & (kPageSize - 1)) <= kPageSize - kSwapStagingSize;
+    }
+}
+
+#endif
@@ -0,0 +1,193 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 09:12:40
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 09:12:40
+ */
+
+#ifndef SPSC_RING_BUFFER_H
+#define SPSC_RING_BUFFER_H
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <condition_variable>
+#include <cstddef>
+
+namespace GuG {
+
+    constexpr std::size_t kCacheLineSize = 64;
+
+    // Messages are handed between threads in batches of this size
+    constexpr std::size_t kQueueBatchSize = 256;
+
+    inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    // Parks one side of the ring once spinning has not made progress.
+    // The sleeping flag is only touched by the parked side, so the fast path of the
+    // other side is a single relaxed load unless someone is actually asleep.
+    class RingWaiter {
+    public:
+        template<typename Ready>
+        void wait(Ready ready) {
+            for (int i = 0; i < kSpinCount; ++i) {
+                if (ready()) return;
+                cpuRelax();
+            }
+            for (int i = 0; i < kYieldCount; ++i) {
+                if (ready()) return;
+                std::this_thread::yield();
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            sleeping_.store(true, std::memory_order_seq_cst);
+            cond_var_.wait(lock, ready);
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+
+        void notify() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleeping_.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                cond_var_.notify_one();
+            }
+        }
+
+    private:
+        static constexpr int kSpinCount = 2048;
+        static constexpr int kYieldCount = 64;
+
+        std::mutex mutex_;
+        std::condition_variable cond_var_;
+        std::atomic<bool> sleeping_{ false };
+    };
+
+    // Bounded single-producer/single-consumer ring.
+    // push blocks while the ring is full (backpressure on the reader), pop blocks while it is empty.
+    // Same interface as ThreadSafeQueue so either can sit between reader and processor.
+    template<typename T>
+    class SpscRingBuffer {
+    public:
+        explicit SpscRingBuffer(std::size_t capacity = 1u << 16)
+            : capacity_(roundUpPow2(capacity)), mask_(capacity_ - 1), buffer_(new T[capacity_]) {}
+
+        SpscRingBuffer(const SpscRingBuffer&) = delete;
+        SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+        void push(T value) {
+            pushBatch(&value, 1);
+        }
+
+        template<typename... Args>
+        void emplace(Args&&... args) {
+            push(T(std::forward<Args>(args)...));
+        }
+
+        // Moves all count values into the ring, waiting for free slots as needed
+        void pushBatch(T* values, std::size_t count) {
+            std::size_t tail = tail_.load(std::memory_order_relaxed);
+            while (count > 0) {
+                std::size_t free = capacity_ - (tail - cached_head_);
+                if (free == 0) {
+                    cached_head_ = head_.load(std::memory_order_acquire);
+                    free = capacity_ - (tail - cached_head_);
+                    if (free == 0) {
+                        not_full_.wait([&] {
+                            cached_head_ = head_.load(std::memory_order_acquire);
+                            return tail - cached_head_ < capacity_;
+                        });
+                        continue;
+                    }
+                }
+                std::size_t n = count < free ? count : free;
+                for (std::size_t i = 0; i < n; ++i) {
+                    buffer_[(tail + i) & mask_] = std::move(values[i]);
+                }
+                tail += n;
+                values += n;
+                count -= n;
+                tail_.store(tail, std::memory_order_release);
+                not_empty_.notify();
+            }
+        }
+
+        bool pop(T& value) {
+            return popBatch(&value, 1) == 1;
+        }
+
+        // Moves up to max values out of the ring, waiting until at least one is available.
+        // Returns 0 only once the ring is drained and finish() was called.
+        std::size_t popBatch(T* values, std::size_t max) {
+            std::size_t head = head_.load(std::memory_order_relaxed);
+            std::size_t available = cached_tail_ - head;
+            if (available == 0) {
+                not_empty_.wait([&] {
+                    cached_tail_ = tail_.load(std::memory_order_acquire);
+                    return cached_tail_ != head || finished_.load(std::memory_order_acquire);
+                });
+                // Re-read after observing finished so the last batch is never lost
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+                available = cached_tail_ - head;
+                if (available == 0) return 0;
+            }
+            std::size_t n = max < available ? max : available;
+            for (std::size_t i = 0; i < n; ++i) {
+                values[i] = std::move(buffer_[(head + i) & mask_]);
+            }
+            head_.store(head + n, std::memory_order_release);
+            not_full_.notify();
+            return n;
+        }
+
+        void finish() {
+            finished_.store(true, std::memory_order_release);
+            not_empty_.notify();
+        }
+
+        bool isFinished() const {
+            return finished_.load(std::memory_order_acquire);
+        }
+
+        bool empty() const {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+
+        // Messages waiting, for monitoring; exact only on the producer or consumer thread
+        std::size_t size() const {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+        }
+
+        std::size_t capacity() const { return capacity_; }
+
+    private:
+        static std::size_t roundUpPow2(std::size_t n) {
+            std::size_t capacity = 1;
+            while (capacity < n) capacity <<= 1;
+            return capacity;
+        }
+
+        const std::size_t capacity_;
+        const std::size_t mask_;
+        std::unique_ptr<T[]> buffer_;
+
+        // Consumer owned
+        alignas(kCacheLineSize) std::atomic<std::size_t> head_{ 0 };
+        std::size_t cached_tail_ = 0;
+        RingWaiter not_empty_;
+
+        // Producer owned
+        alignas(kCacheLineSize) std::atomic<std::size_t> tail_{ 0 };
+        std::size_t cached_head_ = 0;
+        RingWaiter not_full_;
+
+        alignas(kCacheLineSize) std::atomic<bool> finished_{ false };
+    };
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 17:31:04
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 17:31:04
+ */
+
+#ifndef STREAM_READER_H
+#define STREAM_READER_H
+
+#include <sys/stat.h> // For fstat
+#include <fcntl.h>    // For open
+#include <poll.h>     // For poll
+#include <unistd.h>   // For read, close
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <iostream>
+
+namespace GuG {
+
+    // Reads a feed that may still be growing: stdin ("-"), a named pipe, or a regular file that is
+    // being appended to (follow mode, like tail -f). Pipes end when the writer closes them, regular
+    // files end at their current end unless followed.
+    class StreamReader {
+    public:
+        static constexpr size_t kEnd = static_cast<size_t>(-1);
+
+        StreamReader(const char* filepath, bool follow) : follow_(follow) {
+            if (std::strcmp(filepath, "-") == 0) {
+                fd_ = STDIN_FILENO;
+                owns_fd_ = false;
+            }
+            else {
+                fd_ = open(filepath, O_RDONLY);
+                if (fd_ == -1) {
+                    throw std::runtime_error("Error opening file");
+                }
+            }
+            struct stat sb;
+            if (fstat(fd_, &sb) == -1) {
+                if (owns_fd_) close(fd_);
+                throw std::runtime_error("Error getting file type");
+            }
+            regular_ = S_ISREG(sb.st_mode);
+        }
+
+        ~StreamReader() {
+            if (owns_fd_ && fd_ != -1) {
+                if (close(fd_) == -1) {
+                    std::cerr << "Error closing file\n";
+                }
+            }
+        }
+
+        StreamReader(const StreamReader&) = delete;
+        StreamReader& operator=(const StreamReader&) = delete;
+
+        // Waits at most `wait` for data. Returns the number of bytes read, 0 if none arrived in
+        // time, or kEnd once the stream is over.
+        size_t read(std::byte* buffer, size_t capacity, std::chrono::milliseconds wait) {
+            if (regular_) {
+                ssize_t count = readSome(buffer, capacity);
+                if (count > 0) return static_cast<size_t>(count);
+                if (!follow_) return kEnd;
+                // the writer may append more: check again after a short sleep
+                std::this_thread::sleep_for(std::min(wait, kFollowPollInterval));
+                return 0;
+            }
+            pollfd request{ fd_, POLLIN, 0 };
+            int ready = poll(&request, 1, static_cast<int>(wait.count()));
+            if (ready == -1 && errno != EINTR) {
+                throw std::runtime_error("Error waiting for input");
+            }
+            if (ready <= 0) return 0;
+            ssize_t count = readSome(buffer, capacity);
+            return count > 0 ? static_cast<size_t>(count) : kEnd;
+        }
+
+        bool following() const { return regular_ && follow_; }
+
+    private:
+        static constexpr std::chrono::milliseconds kFollowPollInterval{ 1 };
+
+        ssize_t readSome(std::byte* buffer, size_t capacity) {
+            ssize_t count;
+            do {
+                count = ::read(fd_, buffer, capacity);
+            } while (count == -1 && errno == EINTR);
+            if (count == -1) {
+                throw std::runtime_error("Error reading input");
+            }
+            return count;
+        }
+
+        int fd_ = -1;
+        bool owns_fd_ = true;
+        bool regular_ = false;
+        bool follow_ = false;
+    };
+}
+
+#endif
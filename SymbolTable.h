@@ -0,0 +1,218 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 11:05:12
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 22:06:15
+ */
+
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <bit>
+#include <algorithm>
+
+#include "Utility.h"
+
+namespace GuG {
+
+    // Volume and notional of one symbol-bucket, updated together by every trade
+    struct VolumeAccumulator {
+        uint64_t volume = 0;
+        uint64_t notional = 0;  // sum of price * shares, price in 1/10000 dollars
+
+        void add(uint32_t price, uint64_t shares) {
+            notional += static_cast<uint64_t>(price) * shares;
+            volume += shares;
+        }
+
+        void remove(uint32_t price, uint64_t shares) {
+            notional -= static_cast<uint64_t>(price) * shares;
+            volume -= shares;
+        }
+
+        void remove(const VolumeAccumulator& other) {
+            notional -= other.notional;
+            volume -= other.volume;
+        }
+    };
+
+    // Per symbol state indexed directly by the dense 16-bit stock locate.
+    // Buckets are reported once and never read again, so a symbol only keeps the buckets of the
+    // rolling window: a ring of window_buckets accumulators (one without a rolling window) and
+    // their running total, so a trade is two 16-byte updates whatever the bucket width.
+    // Rings are allocated on a symbol's first trade, and a bitmap of symbols with trades in the
+    // window lets a bucket be closed without scanning idle symbols.
+    class SymbolTable {
+    public:
+        explicit SymbolTable(uint32_t window_buckets = 1)
+            : ring_size_(std::max<uint32_t>(window_buckets, 1)) {}
+
+        // Registers (or re-registers) a stock from its directory message, clearing its trades
+        void addStock(uint16_t stock_id, const StockSymbol& symbol) {
+            if (stock_id >= symbols_.size()) {
+                size_t size = static_cast<size_t>(stock_id) + 1;
+                symbols_.resize(size);
+                listed_.resize(size, 0);
+                activity_.resize(size);
+                active_.resize((size + 63) / 64, 0);
+            }
+            symbols_[stock_id] = symbol;
+            listed_[stock_id] = 1;
+            Activity& activity = activity_[stock_id];
+            if (activity.ring != kNoRing) {
+                std::fill(ringOf(activity), ringOf(activity) + ring_size_, VolumeAccumulator{});
+            }
+            activity.window = VolumeAccumulator{};
+            active_[stock_id / 64] &= ~(uint64_t{ 1 } << (stock_id % 64));
+        }
+
+        // Trades must arrive in bucket order. Trades for stocks without a directory entry are
+        // dropped, they could never be reported
+        void addTrade(uint16_t stock_id, uint32_t bucket, uint32_t price, uint64_t shares) {
+            if (stock_id >= symbols_.size()) return;
+            Activity& activity = activity_[stock_id];
+            if (activity.ring == kNoRing) {
+                activity.ring = static_cast<uint32_t>(ring_slots_.size());
+                ring_slots_.resize(ring_slots_.size() + ring_size_);
+            }
+            advance(activity, bucket);
+            ringOf(activity)[activity.head].add(price, shares);
+            activity.window.add(price, shares);
+            active_[stock_id / 64] |= uint64_t{ 1 } << (stock_id % 64);
+        }
+
+        // Starts loading what a trade of the stock updates: its activity and, once it has traded,
+        // the ring slot of its newest bucket
+        void prefetch(uint16_t stock_id) const {
+            if (stock_id >= activity_.size()) return;
+            const Activity& activity = activity_[stock_id];
+            __builtin_prefetch(&activity, 1);
+            if (activity.ring != kNoRing) __builtin_prefetch(&ring_slots_[activity.ring + activity.head], 1);
+        }
+
+        // Trades whose bucket has left the window were already reported and are not touched
+        void removeTrade(uint16_t stock_id, uint32_t bucket, uint32_t price, uint64_t shares) {
+            if (stock_id >= symbols_.size() || bucket + ring_size_ <= open_bucket_) return;
+            Activity& activity = activity_[stock_id];
+            if (activity.ring == kNoRing || bucket > activity.newest) return;
+            uint32_t age = activity.newest - bucket;
+            ringOf(activity)[(activity.head + ring_size_ - age) % ring_size_].remove(price, shares);
+            activity.window.remove(price, shares);
+        }
+
+        // Closes the bucket: fn(stock_id, bucket, window) is called in stock id order for every
+        // listed stock that traded in the bucket or, with a rolling window, in the window ending
+        // with it. Buckets must be closed in order, after all of their trades.
+        template<typename Fn>
+        void closeBucket(uint32_t bucket, Fn&& fn) {
+            scan(bucket, fn, true);
+            open_bucket_ = bucket + 1;
+        }
+
+        // Reports the open bucket like closeBucket so far, without closing it
+        template<typename Fn>
+        void snapshot(uint32_t bucket, Fn&& fn) {
+            scan(bucket, fn, false);
+        }
+
+        // One past the largest stock locate seen so far
+        size_t size() const { return symbols_.size(); }
+        bool listed(uint16_t stock_id) const { return listed_[stock_id] != 0; }
+        const StockSymbol& symbol(uint16_t stock_id) const { return symbols_[stock_id]; }
+
+        // Checkpoint image, see Checkpoint.h
+        template<typename Out>
+        void save(Out& out) const {
+            out.put(ring_size_);
+            out.put(open_bucket_);
+            out.putVector(symbols_);
+            out.putVector(listed_);
+            out.putVector(activity_);
+            out.putVector(ring_slots_);
+            out.putVector(active_);
+        }
+
+        template<typename In>
+        void load(In& in) {
+            in.expect(ring_size_);
+            in.get(open_bucket_);
+            in.getVector(symbols_);
+            in.getVector(listed_);
+            in.getVector(activity_);
+            in.getVector(ring_slots_);
+            in.getVector(active_);
+            size_t size = symbols_.size();
+            if (listed_.size() != size || activity_.size() != size || active_.size() != (size + 63) / 64
+                || ring_slots_.size() % ring_size_ != 0) {
+                in.fail();
+            }
+        }
+
+    private:
+        static constexpr uint32_t kNoRing = UINT32_MAX;
+
+        struct Activity {
+            uint32_t ring = kNoRing;  // offset of the symbol's ring in ring_slots_
+            uint32_t head = 0;        // ring slot of the newest bucket
+            uint32_t newest = 0;      // newest bucket in the ring
+            VolumeAccumulator window; // total of the ring
+        };
+
+        VolumeAccumulator* ringOf(Activity& activity) { return &ring_slots_[activity.ring]; }
+
+        template<typename Fn>
+        void scan(uint32_t bucket, Fn& fn, bool close) {
+            for (size_t word = 0; word < active_.size(); ++word) {
+                uint64_t bits = active_[word];
+                while (bits != 0) {
+                    uint16_t stock_id = static_cast<uint16_t>(word * 64 + std::countr_zero(bits));
+                    bits &= bits - 1;
+                    Activity& activity = activity_[stock_id];
+                    advance(activity, bucket);
+                    const VolumeAccumulator& current = ringOf(activity)[activity.head];
+                    if (listed_[stock_id] && (ring_size_ > 1 ? activity.window.volume : current.volume) != 0) {
+                        fn(stock_id, current, activity.window);
+                    }
+                    if (close) {
+                        advance(activity, bucket + 1);
+                        if (activity.window.volume == 0) {
+                            active_[word] &= ~(uint64_t{ 1 } << (stock_id % 64));
+                        }
+                    }
+                }
+            }
+        }
+
+        // Moves the newest bucket of the ring up to bucket, expiring the buckets that leave it
+        void advance(Activity& activity, uint32_t bucket) {
+            if (bucket <= activity.newest) return;
+            VolumeAccumulator* ring = ringOf(activity);
+            bool empty = activity.window.volume == 0 && activity.window.notional == 0;
+            if (!empty && bucket - activity.newest >= ring_size_) {
+                std::fill(ring, ring + ring_size_, VolumeAccumulator{});
+                activity.window = VolumeAccumulator{};
+            }
+            else if (!empty) {
+                for (uint32_t step = activity.newest; step < bucket; ++step) {
+                    activity.head = activity.head + 1 == ring_size_ ? 0 : activity.head + 1;
+                    activity.window.remove(ring[activity.head]);
+                    ring[activity.head] = VolumeAccumulator{};
+                }
+            }
+            activity.newest = bucket;
+        }
+
+        const uint32_t ring_size_;
+        uint32_t open_bucket_ = 0;  // first bucket not closed yet
+        std::vector<StockSymbol> symbols_;
+        std::vector<uint8_t> listed_;
+        std::vector<Activity> activity_;
+        std::vector<VolumeAccumulator> ring_slots_;
+        std::vector<uint64_t> active_;  // one bit per stock with trades in the window
+    };
+}
+
+#endif
@@ -38,6 +38,25 @@ namespace GuG {
             return true;
         }
 
+        void pushBatch(T* values, std::size_t count) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (std::size_t i = 0; i < count; ++i) {
+                queue_.push(std::move(values[i]));
+            }
+            cond_var_.notify_one();
+        }
+
+        std::size_t popBatch(T* values, std::size_t max) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_var_.wait(lock, [this] { return !queue_.empty() || finished_; });
+            std::size_t n = 0;
+            while (n < max && !queue_.empty()) {
+                values[n++] = std::move(queue_.front());
+                queue_.pop();
+            }
+            return n;
+        }
+
         void finish() {
             std::lock_guard<std::mutex> lock(mutex_);
             finished_ = true;
@@ -54,6 +73,11 @@ namespace GuG {
             return queue_.empty();
         }
 
+        std::size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return queue_.size();
+        }
+
         template<typename... Args>
         void emplace(Args&&... args) {
             std::lock_guard<std::mutex> lock(mutex_);
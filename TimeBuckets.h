@@ -0,0 +1,37 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 16:48:22
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 16:48:22
+ */
+
+#ifndef TIME_BUCKETS_H
+#define TIME_BUCKETS_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "Message.h"
+
+namespace GuG {
+
+    constexpr uint64_t kNanosPerDay = 24 * kNanosPerHour;
+
+    // The intervals VWAP is reported for: fixed width buckets from midnight, plus an optional
+    // rolling window spanning the last `window` buckets
+    struct TimeBuckets {
+        uint64_t width = kNanosPerHour;
+        uint32_t window = 0;  // buckets in the rolling window, 0 without a rolling VWAP
+
+        uint32_t index(uint64_t time) const { return static_cast<uint32_t>(time / width); }
+        uint64_t start(uint32_t bucket) const { return bucket * width; }
+
+        // Buckets needed to cover a day; all of them are reported
+        uint32_t perDay() const { return static_cast<uint32_t>((kNanosPerDay + width - 1) / width); }
+
+        bool hourly() const { return width == kNanosPerHour; }
+        bool rolling() const { return window > 0; }
+    };
+}
+
+#endif
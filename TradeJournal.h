@@ -0,0 +1,156 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 23:58:14
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 23:58:14
+ */
+
+#ifndef TRADE_JOURNAL_H
+#define TRADE_JOURNAL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+namespace GuG {
+
+    struct TradeEntry {
+        uint32_t price;
+        uint32_t shares;        // low 32 bits of the executed shares
+        uint32_t bucket;        // bucket the trade was counted in
+        uint16_t stock_id;
+        uint8_t shares_high;    // bits 32-39 of the shares, cross trades carry 64-bit counts
+        uint8_t live;           // 0 marks an empty or broken slot
+
+        uint64_t volume() const { return (uint64_t{ shares_high } << 32) | shares; }
+    };
+    static_assert(sizeof(TradeEntry) == 16, "TradeEntry should stay one quarter of a cache line");
+
+    // The trades a Broken Trade (B) message can refer to, keyed by the full 64-bit match number.
+    // Match numbers are assigned in increasing order over the day, so the journal is a ring of
+    // pages indexed by match number: entry (match % kPageSize) of page (match / kPageSize).
+    // It keeps the trades of the last `horizon` match numbers; a page that falls out of the
+    // horizon is reused for the next one. Memory is bounded by the horizon, and once every page
+    // of the ring has been used recording a trade never allocates.
+    class TradeJournal {
+    public:
+        static constexpr size_t kPageBits = 12;
+        static constexpr size_t kPageSize = size_t{ 1 } << kPageBits;   // 64 KB of entries
+
+        explicit TradeJournal(uint64_t horizon = 1u << 22)
+            : pages_((std::max<uint64_t>(horizon, 1) + kPageSize - 1) / kPageSize + 1) {}
+
+        // Trades older than the horizon are dropped
+        void record(uint64_t match, uint16_t stock_id, uint32_t price, uint64_t shares, uint32_t bucket) {
+            uint64_t number = match >> kPageBits;
+            if (number > newest_ || newest_ == kNoPage) newest_ = number;
+            else if (newest_ - number >= pages_.size()) return;
+            Page& page = pages_[number % pages_.size()];
+            if (page.number != number) reset(page, number);
+            TradeEntry& entry = page.entries[match & (kPageSize - 1)];
+            if (!entry.live) {
+                ++page.live;
+                ++size_;
+            }
+            entry = { price, static_cast<uint32_t>(shares), bucket, stock_id, static_cast<uint8_t>(shares >> 32), 1 };
+        }
+
+        // The trade with this match number, nullptr if it was never recorded, broken or dropped
+        const TradeEntry* find(uint64_t match) const {
+            uint64_t number = match >> kPageBits;
+            if (newest_ == kNoPage || number > newest_ || newest_ - number >= pages_.size()) return nullptr;
+            const Page& page = pages_[number % pages_.size()];
+            if (page.number != number) return nullptr;
+            const TradeEntry& entry = page.entries[match & (kPageSize - 1)];
+            return entry.live ? &entry : nullptr;
+        }
+
+        // Starts loading the entry of a match number a Broken Trade refers to
+        void prefetch(uint64_t match) const {
+            const Page& page = pages_[(match >> kPageBits) % pages_.size()];
+            if (!page.entries.empty()) __builtin_prefetch(&page.entries[match & (kPageSize - 1)]);
+        }
+
+        // A broken trade cannot be broken again
+        bool erase(uint64_t match) {
+            TradeEntry* entry = const_cast<TradeEntry*>(find(match));
+            if (entry == nullptr) return false;
+            entry->live = 0;
+            --pages_[(match >> kPageBits) % pages_.size()].live;
+            --size_;
+            return true;
+        }
+
+        // Trades held, including pages past the horizon that have not been reused yet
+        size_t size() const { return size_; }
+
+        uint64_t horizon() const { return (pages_.size() - 1) * kPageSize; }
+
+        // Checkpoint image, see Checkpoint.h: the pages within the horizon
+        template<typename Out>
+        void save(Out& out) const {
+            out.put(newest_);
+            uint64_t count = std::count_if(pages_.begin(), pages_.end(), [this](const Page& page) { return current(page); });
+            out.put(count);
+            for (const Page& page : pages_) {
+                if (!current(page)) continue;
+                out.put(page.number);
+                out.putVector(page.entries);
+            }
+        }
+
+        // Pages outside this journal's horizon are left out, so a checkpoint can be resumed
+        // with another --journal-horizon
+        template<typename In>
+        void load(In& in) {
+            uint64_t count = 0;
+            in.get(newest_);
+            in.get(count);
+            for (Page& page : pages_) page = Page{};
+            size_ = 0;
+            for (uint64_t i = 0; i < count; ++i) {
+                uint64_t number = 0;
+                std::vector<TradeEntry> entries;
+                in.get(number);
+                in.getVector(entries);
+                if (entries.size() != kPageSize || number > newest_) in.fail();
+                if (newest_ - number >= pages_.size()) continue;
+                Page& page = pages_[number % pages_.size()];
+                if (page.number != kNoPage) in.fail();
+                page.number = number;
+                page.entries = std::move(entries);
+                page.live = std::count_if(page.entries.begin(), page.entries.end(), [](const TradeEntry& entry) { return entry.live; });
+                size_ += page.live;
+            }
+        }
+
+    private:
+        static constexpr uint64_t kNoPage = ~uint64_t{ 0 };
+
+        struct Page {
+            uint64_t number = kNoPage;
+            size_t live = 0;
+            std::vector<TradeEntry> entries;
+        };
+
+        bool current(const Page& page) const {
+            return page.number != kNoPage && newest_ - page.number < pages_.size();
+        }
+
+        void reset(Page& page, uint64_t number) {
+            // pages are allocated on first use, then cleared in place
+            if (page.entries.empty()) page.entries.resize(kPageSize, TradeEntry{});
+            else std::fill(page.entries.begin(), page.entries.end(), TradeEntry{});
+            size_ -= page.live;
+            page.number = number;
+            page.live = 0;
+        }
+
+        std::vector<Page> pages_;
+        uint64_t newest_ = kNoPage;
+        size_t size_ = 0;
+    };
+}
+
+#endif
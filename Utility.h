@@ -8,6 +8,8 @@
 #define UTILITY_H
 
 #include <string>
+#include <string_view>
+#include <cstring>
 #include <cstdint>
 #include <cassert>
 #include <cctype>
@@ -85,18 +87,54 @@ namespace GuG {
         return std::string(value);;
     }
 
-    // Specialization for a 6-byte timestamp
+    // Stock symbol kept inline as its 8 raw bytes, padding after the symbol zeroed
+    struct StockSymbol {
+        char value[8] = {};
+
+        std::string_view view() const {
+            return std::string_view(value, strnlen(value, sizeof(value)));
+        }
+    };
+
+    // Same trimming rules as readStock, without the std::string: one 8-byte load, a mask of the
+    // bytes that are NUL or whitespace, and everything from the first such byte cleared
+    StockSymbol readStockSymbol(const std::byte*& buffer) {
+        constexpr uint64_t ones = 0x0101010101010101ULL;
+        constexpr uint64_t highs = 0x8080808080808080ULL;
+        uint64_t raw;
+        std::memcpy(&raw, buffer, sizeof(raw));
+        buffer += 8;
+
+        auto zeroBytes = [](uint64_t x) { return (x - ones) & ~x & highs; };
+        uint64_t low7 = raw & ~highs;
+        // '\t' .. '\r' (0x09 - 0x0d) on ASCII bytes: at least 0x09 and not at least 0x0e
+        uint64_t control_space = (low7 + ones * (0x80 - 0x09)) & ~(low7 + ones * (0x80 - 0x0e)) & ~raw & highs;
+        uint64_t stop = zeroBytes(raw) | zeroBytes(raw ^ (ones * ' ')) | control_space;
+
+        StockSymbol symbol;
+        if (stop != 0) {
+            // zeroBytes may flag bytes after a real match, never before it
+            unsigned keep = __builtin_ctzll(stop) / 8;
+            raw &= keep == 0 ? 0 : (~0ULL >> (64 - 8 * keep));
+        }
+        std::memcpy(symbol.value, &raw, sizeof(raw));
+        return symbol;
+    }
+
+    // Specialization for a 6-byte timestamp, read as a 2-byte and a 4-byte word
     uint64_t readTimeStamp(const std::byte*& buffer, bool bigEndian = true) {
-        uint64_t timestamp = 0;
+        uint16_t high;
+        uint32_t low;
+        uint64_t timestamp;
         if (bigEndian) {
-            for (int i = 0; i < 6; ++i) {
-                timestamp |= (static_cast<uint64_t>(static_cast<unsigned char>(buffer[i]))) << ((5 - i) * 8);
-            }
+            std::memcpy(&high, buffer, sizeof(high));
+            std::memcpy(&low, buffer + 2, sizeof(low));
+            timestamp = (static_cast<uint64_t>(swap_endian(high)) << 32) | swap_endian(low);
         }
         else {
-            for (int i = 0; i < 6; ++i) {
-                timestamp |= (static_cast<uint64_t>(static_cast<unsigned char>(buffer[i]))) << (i * 8);
-            }
+            std::memcpy(&low, buffer, sizeof(low));
+            std::memcpy(&high, buffer + 4, sizeof(high));
+            timestamp = (static_cast<uint64_t>(high) << 32) | low;
         }
         buffer += 6;
         return timestamp;
@@ -0,0 +1,373 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 12:10:26
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 20:14:37
+ */
+
+#ifndef VWAP_OUTPUT_H
+#define VWAP_OUTPUT_H
+
+#include <unistd.h>   // For write, lseek, fdatasync
+#include <cerrno>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <cstdio>
+#include <cstring>
+#include <charconv>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+
+#include "Utility.h"
+#include "SymbolTable.h"
+#include "TimeBuckets.h"
+#include "BarMetrics.h"
+#include "OrderBook.h"
+
+namespace GuG {
+
+    // One line of output.csv, still in raw accumulator units
+    struct VwapRow {
+        StockSymbol symbol;
+        uint16_t stock_id;
+        uint32_t bucket;
+        uint64_t volume;
+        uint64_t notional;
+        uint64_t window_volume = 0;     // rolling window, only with TimeBuckets::rolling()
+        uint64_t window_notional = 0;
+        [[no_unique_address]] TradeBars::State bar{};  // bar metrics of the bucket, if built with any
+        [[no_unique_address]] RowBookQuote book{};     // top of book at the close, with -DGUG_WITH_BOOK
+    };
+
+    // Longest formatted row: 8 byte symbol, 5 digit id, HH:MM:SS.mmm, two prices below 2^64 / 10000
+    // and the bar metric and book columns
+    constexpr size_t kMaxVwapRowSize = 128 + TradeBars::kMaxSize + (kBookEnabled ? kMaxBookQuoteSize : 0);
+
+    // Hourly buckets keep the original HOUR_AFTER_MIDNIGHT column, other widths give the bucket
+    // start as HH:MM:SS (HH:MM:SS.mmm for widths that are not whole seconds).
+    // A rolling window adds a ROLLING_VWAP column, a build with bar metrics their columns and a
+    // build with the order book its top of book columns.
+    std::string vwapHeader(const TimeBuckets& buckets) {
+        std::string header = "STOCK_SYMBOL,STOCK_ID,";
+        header += buckets.hourly() ? "HOUR_AFTER_MIDNIGHT" : "BUCKET_START";
+        header += ",VWAP";
+        if (buckets.rolling()) {
+            header += ",ROLLING_VWAP";
+        }
+        header += TradeBars::columns();
+        if constexpr (kBookEnabled) {
+            header += kBookColumns;
+        }
+        header += "\n";
+        return header;
+    }
+
+    namespace detail {
+        inline char* appendText(char* out, std::string_view text) {
+            std::memcpy(out, text.data(), text.size());
+            return out + text.size();
+        }
+
+        inline char* appendTwoDigits(char* out, uint64_t value) {
+            out[0] = static_cast<char>('0' + value / 10);
+            out[1] = static_cast<char>('0' + value % 10);
+            return out + 2;
+        }
+
+        // write(2) until everything is written; false on an error
+        inline bool writeAll(int fd, const char* data, size_t size) {
+            while (size != 0) {
+                ssize_t written = ::write(fd, data, size);
+                if (written == -1) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+        // Same digits as std::fixed << std::setprecision(4)
+        inline char* appendPrice(char* out, uint64_t notional, uint64_t volume) {
+            return std::to_chars(out, out + 32, notional / 10000.0 / volume, std::chars_format::fixed, 4).ptr;
+        }
+    }
+
+    // Formats one row at out, which must have kMaxVwapRowSize bytes free; returns the end of the row
+    inline char* formatVwapRow(char* out, const VwapRow& row, const TimeBuckets& buckets) {
+        out = detail::appendText(out, row.symbol.view());
+        *out++ = ',';
+        out = std::to_chars(out, out + 8, row.stock_id).ptr;
+        *out++ = ',';
+        if (buckets.hourly()) {
+            out = std::to_chars(out, out + 12, row.bucket).ptr;
+        }
+        else {
+            uint64_t start = buckets.start(row.bucket);
+            uint64_t seconds = start / 1000000000ULL;
+            out = detail::appendTwoDigits(out, seconds / 3600);
+            *out++ = ':';
+            out = detail::appendTwoDigits(out, seconds / 60 % 60);
+            *out++ = ':';
+            out = detail::appendTwoDigits(out, seconds % 60);
+            if (buckets.width % 1000000000ULL != 0) {
+                uint64_t millis = start / 1000000ULL % 1000;
+                *out++ = '.';
+                *out++ = static_cast<char>('0' + millis / 100);
+                out = detail::appendTwoDigits(out, millis % 100);
+            }
+        }
+        *out++ = ',';
+        // with a rolling window a stock can have no trades in the bucket itself
+        if (row.volume != 0) {
+            out = detail::appendPrice(out, row.notional, row.volume);
+        }
+        if (buckets.rolling()) {
+            *out++ = ',';
+            out = detail::appendPrice(out, row.window_notional, row.window_volume);
+        }
+        out = TradeBars::format(out, row.bar);
+        if constexpr (kBookEnabled) {
+            out = formatBookQuote(out, row.book);
+        }
+        *out++ = '\n';
+        return out;
+    }
+
+    // Formats rows on its own thread into a large buffer that is written to fd with few write
+    // calls, so closing a bucket costs a processing thread only the handoff of its rows.
+    // Buffered rows are written when the buffer fills, after kIdleFlush without new rows (so a
+    // stream's closed buckets show up promptly) and on close().
+    // An optional sink sees every batch of rows on the writer thread too; if it throws, the error
+    // is reported and the sink is not called again.
+    class AsyncVwapWriter {
+    public:
+        using RowSink = std::function<void(const std::vector<VwapRow>&)>;
+
+        static constexpr size_t kBufferSize = 4u << 20;
+        static constexpr std::chrono::milliseconds kIdleFlush{ 10 };
+
+        // Rows are appended at the current offset of fd; without header the file is being
+        // continued and already starts with one
+        AsyncVwapWriter(int fd, const TimeBuckets& buckets, RowSink sink = nullptr, bool header = true)
+            : fd_(fd), buckets_(buckets), sink_(std::move(sink)), buffer_(new char[kBufferSize]) {
+            off_t offset = ::lseek(fd, 0, SEEK_CUR);
+            written_ = offset == -1 ? 0 : static_cast<uint64_t>(offset);
+            if (header) {
+                std::string text = vwapHeader(buckets);
+                std::memcpy(buffer_.get(), text.data(), text.size());
+                size_ = text.size();
+            }
+            thread_ = std::thread([this] { run(); });
+        }
+
+        ~AsyncVwapWriter() { close(); }
+
+        AsyncVwapWriter(const AsyncVwapWriter&) = delete;
+        AsyncVwapWriter& operator=(const AsyncVwapWriter&) = delete;
+
+        void submit(std::vector<VwapRow>&& rows) {
+            if (rows.empty()) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pending_.push_back({ std::move(rows), nullptr });
+            }
+            ready_.notify_one();
+        }
+
+        // Once everything submitted before is on disk, calls on_synced with the file offset
+        // reached, from the writer thread
+        void mark(std::function<void(uint64_t)> on_synced) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pending_.push_back({ {}, std::move(on_synced) });
+            }
+            ready_.notify_one();
+        }
+
+        // Writes everything submitted so far and stops the writer thread
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (closed_) return;
+                closed_ = true;
+            }
+            ready_.notify_one();
+            thread_.join();
+        }
+
+    private:
+        struct Pending {
+            std::vector<VwapRow> rows;
+            std::function<void(uint64_t)> on_synced;
+        };
+
+        void run() {
+            Pending item;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    if (!ready_.wait_for(lock, kIdleFlush, [this] { return closed_ || !pending_.empty(); })) {
+                        lock.unlock();
+                        flush();
+                        lock.lock();
+                        ready_.wait(lock, [this] { return closed_ || !pending_.empty(); });
+                    }
+                    if (pending_.empty()) break;  // closed and drained
+                    item = std::move(pending_.front());
+                    pending_.pop_front();
+                }
+                if (item.on_synced) {
+                    flush();
+                    ::fdatasync(fd_);
+                    item.on_synced(written_);
+                    continue;
+                }
+                const std::vector<VwapRow>& rows = item.rows;
+                for (const VwapRow& row : rows) {
+                    if (kBufferSize - size_ < kMaxVwapRowSize) {
+                        flush();
+                    }
+                    size_ = formatVwapRow(buffer_.get() + size_, row, buckets_) - buffer_.get();
+                }
+                if (sink_) {
+                    try {
+                        sink_(rows);
+                    }
+                    catch (const std::exception& e) {
+                        std::cerr << e.what() << "\n";
+                        sink_ = nullptr;
+                    }
+                }
+            }
+            flush();
+        }
+
+        void flush() {
+            if (!detail::writeAll(fd_, buffer_.get(), size_)) {
+                std::cerr << "Error writing output\n";
+            }
+            written_ += size_;
+            size_ = 0;
+        }
+
+        const int fd_;
+        const TimeBuckets buckets_;
+        RowSink sink_;
+        std::unique_ptr<char[]> buffer_;
+        size_t size_ = 0;
+        uint64_t written_ = 0;  // file offset of buffer_
+        std::mutex mutex_;
+        std::condition_variable ready_;
+        std::deque<Pending> pending_;
+        bool closed_ = false;
+        std::thread thread_;
+    };
+
+    // Collects each shard's rows for a bucket and hands the bucket to the writer once every shard
+    // has reported it. Rows are written in stock id order, so the output does not depend on the
+    // number of shards.
+    class BucketMerger {
+    public:
+        BucketMerger(size_t shard_count, const TimeBuckets& buckets, AsyncVwapWriter& writer)
+            : shard_count_(shard_count), buckets_(buckets), writer_(writer) {}
+
+        // Shards must submit their buckets in increasing order
+        void submit(uint32_t bucket, std::vector<VwapRow>&& rows) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (shard_count_ == 1) {
+                writer_.submit(std::move(rows));
+            }
+            else {
+                Pending& pending = pending_[bucket];
+                pending.rows.insert(pending.rows.end(), rows.begin(), rows.end());
+                if (++pending.submitted < shard_count_) {
+                    return;
+                }
+                std::sort(pending.rows.begin(), pending.rows.end(),
+                    [](const VwapRow& a, const VwapRow& b) { return a.stock_id < b.stock_id; });
+                writer_.submit(std::move(pending.rows));
+                pending_.erase(bucket);
+            }
+            // progress is reported once per hour whatever the bucket width
+            uint64_t last_hour = (buckets_.start(bucket + 1) - 1) / kNanosPerHour;
+            if (last_hour != (buckets_.start(bucket + 2) - 1) / kNanosPerHour) {
+                std::cout << "Finished Processing Data of Hour: " << last_hour << "\n";
+            }
+        }
+
+    private:
+        struct Pending {
+            std::vector<VwapRow> rows;
+            size_t submitted = 0;
+        };
+
+        const size_t shard_count_;
+        const TimeBuckets buckets_;
+        AsyncVwapWriter& writer_;
+        std::mutex mutex_;
+        std::map<uint32_t, Pending> pending_;
+    };
+
+    // Intraday snapshots of the open bucket for streaming input. Shards submit their rows on every
+    // publish tick; once every shard has submitted a snapshot it replaces the file at `path`
+    // through a rename, so readers never see a partly written snapshot.
+    class LivePublisher {
+    public:
+        LivePublisher(size_t shard_count, const TimeBuckets& buckets, std::string path)
+            : shard_count_(shard_count), buckets_(buckets), path_(std::move(path)) {}
+
+        // Each shard numbers its snapshots 0, 1, 2, ...
+        void submit(uint64_t snapshot, std::vector<VwapRow>&& rows) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Pending& pending = pending_[snapshot];
+            pending.rows.insert(pending.rows.end(), rows.begin(), rows.end());
+            if (++pending.submitted < shard_count_) {
+                return;
+            }
+            std::sort(pending.rows.begin(), pending.rows.end(),
+                [](const VwapRow& a, const VwapRow& b) { return a.stock_id < b.stock_id; });
+            std::string text = vwapHeader(buckets_);
+            size_t size = text.size();
+            text.resize(size + pending.rows.size() * kMaxVwapRowSize);
+            for (const VwapRow& row : pending.rows) {
+                size = formatVwapRow(text.data() + size, row, buckets_) - text.data();
+            }
+            std::string temp_path = path_ + ".tmp";
+            {
+                std::ofstream out(temp_path, std::ios::out | std::ios::trunc | std::ios::binary);
+                out.write(text.data(), static_cast<std::streamsize>(size));
+            }
+            if (std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+                std::cerr << "Error publishing " << path_ << "\n";
+            }
+            pending_.erase(snapshot);
+        }
+
+    private:
+        struct Pending {
+            std::vector<VwapRow> rows;
+            size_t submitted = 0;
+        };
+
+        const size_t shard_count_;
+        const TimeBuckets buckets_;
+        const std::string path_;
+        std::mutex mutex_;
+        std::map<uint64_t, Pending> pending_;
+    };
+}
+
+#endif
@@ -0,0 +1,399 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 20:02:51
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 20:02:51
+ */
+
+#ifndef VWAP_STORE_H
+#define VWAP_STORE_H
+
+#include <fcntl.h>    // For open
+#include <unistd.h>   // For pread, close, unlink
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <stdexcept>
+
+#include "Utility.h"
+#include "TimeBuckets.h"
+#include "VwapOutput.h"
+#include "MemoryMappedFileReader.h"
+
+namespace GuG {
+
+    // Binary twin of output.csv that other processes can mmap and read without parsing.
+    // Layout, native byte order, every section starting on a 64-byte boundary:
+    //   VwapStoreHeader
+    //   one column per VwapColumn, `rows` fixed width values each, in output.csv row order
+    //   symbol index: a VwapStoreSymbol per stock in stock id order, then the row numbers
+    //   (uint32) of every stock, each stock's run starting at its `first_row`
+    enum VwapColumn : uint32_t {
+        kSymbolColumn,          // StockSymbol, NUL padded
+        kStockIdColumn,         // uint16_t
+        kBucketColumn,          // uint32_t, see TimeBuckets::start
+        kVwapColumn,            // double, NaN when the stock only traded earlier in the window
+        kVolumeColumn,          // uint64_t shares
+        kNotionalColumn,        // uint64_t sum of price * shares, price in 1/10000 dollars
+        kWindowVwapColumn,      // double, rolling window; NaN without one
+        kWindowVolumeColumn,    // uint64_t
+        kWindowNotionalColumn,  // uint64_t
+        kVwapColumnCount
+    };
+
+    constexpr std::array<uint32_t, kVwapColumnCount> kVwapColumnWidth = { 8, 2, 4, 8, 8, 8, 8, 8, 8 };
+
+    struct VwapStoreHeader {
+        static constexpr char kMagic[8] = { 'G', 'u', 'G', 'V', 'W', 'A', 'P', '\0' };
+        static constexpr uint32_t kVersion = 1;
+        static constexpr uint32_t kByteOrder = 0x01020304;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;        // kByteOrder as written by the producing machine
+        uint64_t bucket_width;      // TimeBuckets::width, ns
+        uint32_t window;            // TimeBuckets::window
+        uint32_t column_count;
+        uint64_t rows;
+        uint64_t column_offset[kVwapColumnCount];
+        uint64_t symbol_count;
+        uint64_t symbols_offset;    // VwapStoreSymbol[symbol_count]
+        uint64_t row_index_offset;  // uint32_t[rows]
+        uint64_t file_size;
+    };
+
+    struct VwapStoreSymbol {
+        StockSymbol symbol;         // last symbol the stock was reported under
+        uint16_t stock_id;
+        uint16_t reserved;
+        uint32_t row_count;
+        uint64_t first_row;         // position of the stock's run in the row index
+    };
+
+    static_assert(sizeof(VwapStoreSymbol) == 24);
+
+    namespace detail {
+        constexpr uint64_t kStoreAlignment = 64;
+
+        constexpr uint64_t alignStore(uint64_t offset) {
+            return (offset + kStoreAlignment - 1) & ~(kStoreAlignment - 1);
+        }
+    }
+
+    // Builds a store from the rows of output.csv, appended in order. Columns are buffered and
+    // spilled to unlinked temporary files, so memory stays bounded whatever the bucket width;
+    // finish() lays them out in one pass into `path`.tmp and renames it to `path`, so readers
+    // never map a partial store.
+    class VwapStoreWriter {
+    public:
+        VwapStoreWriter(std::string path, const TimeBuckets& buckets)
+            : path_(std::move(path)), temp_path_(path_ + ".tmp"), buckets_(buckets) {
+            for (uint32_t column = 0; column < kVwapColumnCount; ++column) {
+                std::string spill_path = temp_path_ + "." + std::to_string(column);
+                columns_[column].fd = open(spill_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+                if (columns_[column].fd == -1) {
+                    closeSpills();
+                    throw std::runtime_error("Error creating " + spill_path);
+                }
+                unlink(spill_path.c_str());
+                columns_[column].width = kVwapColumnWidth[column];
+            }
+        }
+
+        ~VwapStoreWriter() {
+            closeSpills();
+        }
+
+        VwapStoreWriter(const VwapStoreWriter&) = delete;
+        VwapStoreWriter& operator=(const VwapStoreWriter&) = delete;
+
+        void append(const std::vector<VwapRow>& rows) {
+            if (failed_) return;
+            if (rows_ + rows.size() > UINT32_MAX) {
+                fail("Too many rows for the binary output");
+            }
+            constexpr double kNoVwap = std::numeric_limits<double>::quiet_NaN();
+            for (const VwapRow& row : rows) {
+                double vwap = row.volume != 0 ? row.notional / 10000.0 / row.volume : kNoVwap;
+                double window_vwap = row.window_volume != 0 ? row.window_notional / 10000.0 / row.window_volume : kNoVwap;
+                push(kSymbolColumn, row.symbol);
+                push(kStockIdColumn, row.stock_id);
+                push(kBucketColumn, row.bucket);
+                push(kVwapColumn, vwap);
+                push(kVolumeColumn, row.volume);
+                push(kNotionalColumn, row.notional);
+                push(kWindowVwapColumn, window_vwap);
+                push(kWindowVolumeColumn, row.window_volume);
+                push(kWindowNotionalColumn, row.window_notional);
+
+                if (row.stock_id >= stocks_.size()) {
+                    stocks_.resize(static_cast<size_t>(row.stock_id) + 1);
+                }
+                Stock& stock = stocks_[row.stock_id];
+                stock.symbol = row.symbol;
+                stock.rows.push_back(static_cast<uint32_t>(rows_));
+                ++rows_;
+            }
+        }
+
+        // Writes the store; throws std::runtime_error if it or an earlier append failed
+        void finish() {
+            if (failed_) {
+                fail("Binary output " + path_ + " not written");
+            }
+            int fd = open(temp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd == -1) {
+                fail("Error creating " + temp_path_);
+            }
+            offset_ = 0;
+            try {
+                VwapStoreHeader header{};
+                std::memcpy(header.magic, VwapStoreHeader::kMagic, sizeof(header.magic));
+                header.version = VwapStoreHeader::kVersion;
+                header.byte_order = VwapStoreHeader::kByteOrder;
+                header.bucket_width = buckets_.width;
+                header.window = buckets_.window;
+                header.column_count = kVwapColumnCount;
+                header.rows = rows_;
+                emit(fd, &header, sizeof(header));
+
+                for (uint32_t column = 0; column < kVwapColumnCount; ++column) {
+                    pad(fd);
+                    header.column_offset[column] = offset_;
+                    copyColumn(fd, columns_[column]);
+                }
+
+                std::vector<VwapStoreSymbol> symbols;
+                uint64_t first_row = 0;
+                for (size_t stock_id = 0; stock_id < stocks_.size(); ++stock_id) {
+                    const Stock& stock = stocks_[stock_id];
+                    if (stock.rows.empty()) continue;
+                    symbols.push_back(VwapStoreSymbol{ stock.symbol, static_cast<uint16_t>(stock_id), 0,
+                        static_cast<uint32_t>(stock.rows.size()), first_row });
+                    first_row += stock.rows.size();
+                }
+                pad(fd);
+                header.symbol_count = symbols.size();
+                header.symbols_offset = offset_;
+                emit(fd, symbols.data(), symbols.size() * sizeof(VwapStoreSymbol));
+
+                pad(fd);
+                header.row_index_offset = offset_;
+                for (const Stock& stock : stocks_) {
+                    emit(fd, stock.rows.data(), stock.rows.size() * sizeof(uint32_t));
+                }
+                header.file_size = offset_;
+
+                if (pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+                    fail("Error writing " + temp_path_);
+                }
+            }
+            catch (...) {
+                close(fd);
+                unlink(temp_path_.c_str());
+                throw;
+            }
+            if (close(fd) == -1 || std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+                unlink(temp_path_.c_str());
+                fail("Error writing " + path_);
+            }
+            closeSpills();
+        }
+
+    private:
+        static constexpr size_t kSpillSize = 1u << 20;
+
+        struct Column {
+            int fd = -1;
+            uint32_t width = 0;
+            uint64_t spilled = 0;           // bytes already in the spill file
+            std::vector<char> buffer;
+        };
+
+        struct Stock {
+            StockSymbol symbol;
+            std::vector<uint32_t> rows;
+        };
+
+        template<typename T>
+        void push(VwapColumn column, const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            Column& target = columns_[column];
+            const char* bytes = reinterpret_cast<const char*>(&value);
+            target.buffer.insert(target.buffer.end(), bytes, bytes + sizeof(T));
+            if (target.buffer.size() >= kSpillSize) {
+                if (!detail::writeAll(target.fd, target.buffer.data(), target.buffer.size())) {
+                    fail("Error spilling binary output");
+                }
+                target.spilled += target.buffer.size();
+                target.buffer.clear();
+            }
+        }
+
+        void copyColumn(int fd, const Column& column) {
+            std::vector<char> chunk(std::min<uint64_t>(column.spilled, kSpillSize));
+            for (uint64_t position = 0; position < column.spilled;) {
+                ssize_t count = pread(column.fd, chunk.data(), std::min<uint64_t>(chunk.size(), column.spilled - position), position);
+                if (count <= 0) {
+                    if (count == -1 && errno == EINTR) continue;
+                    fail("Error reading back binary output");
+                }
+                emit(fd, chunk.data(), static_cast<size_t>(count));
+                position += static_cast<uint64_t>(count);
+            }
+            emit(fd, column.buffer.data(), column.buffer.size());
+        }
+
+        void emit(int fd, const void* data, size_t size) {
+            if (!detail::writeAll(fd, static_cast<const char*>(data), size)) {
+                fail("Error writing " + temp_path_);
+            }
+            offset_ += size;
+        }
+
+        void pad(int fd) {
+            static constexpr char zeros[detail::kStoreAlignment] = {};
+            emit(fd, zeros, detail::alignStore(offset_) - offset_);
+        }
+
+        [[noreturn]] void fail(const std::string& error) {
+            failed_ = true;
+            throw std::runtime_error(error);
+        }
+
+        void closeSpills() {
+            for (Column& column : columns_) {
+                if (column.fd != -1) {
+                    close(column.fd);
+                    column.fd = -1;
+                }
+            }
+        }
+
+        const std::string path_;
+        const std::string temp_path_;
+        const TimeBuckets buckets_;
+        std::array<Column, kVwapColumnCount> columns_;
+        std::vector<Stock> stocks_;
+        uint64_t rows_ = 0;
+        uint64_t offset_ = 0;
+        bool failed_ = false;
+    };
+
+    // Read-only view of a store written by VwapStoreWriter. Columns are spans straight into the
+    // mapping, so opening a store costs the validation of its header and nothing per row.
+    class VwapStore {
+    public:
+        explicit VwapStore(const char* filepath) : file_(filepath) {
+            base_ = static_cast<const char*>(file_.data());
+            if (file_.size() < sizeof(VwapStoreHeader)) {
+                throw std::runtime_error("Not a VWAP store");
+            }
+            std::memcpy(&header_, base_, sizeof(header_));
+            if (std::memcmp(header_.magic, VwapStoreHeader::kMagic, sizeof(header_.magic)) != 0) {
+                throw std::runtime_error("Not a VWAP store");
+            }
+            if (header_.version != VwapStoreHeader::kVersion || header_.byte_order != VwapStoreHeader::kByteOrder
+                || header_.column_count != kVwapColumnCount) {
+                throw std::runtime_error("Unsupported VWAP store version or byte order");
+            }
+            bool valid = header_.file_size == file_.size() && header_.bucket_width != 0 && header_.rows <= UINT32_MAX
+                && header_.symbol_count <= UINT16_MAX + 1;
+            for (uint32_t column = 0; column < kVwapColumnCount; ++column) {
+                valid = valid && fits(header_.column_offset[column], header_.rows * kVwapColumnWidth[column]);
+            }
+            valid = valid && fits(header_.symbols_offset, header_.symbol_count * sizeof(VwapStoreSymbol))
+                && fits(header_.row_index_offset, header_.rows * sizeof(uint32_t));
+            if (valid) {
+                for (const VwapStoreSymbol& symbol : symbols()) {
+                    valid = valid && symbol.first_row <= header_.rows && symbol.row_count <= header_.rows - symbol.first_row;
+                }
+            }
+            if (!valid) {
+                throw std::runtime_error("Corrupt VWAP store");
+            }
+        }
+
+        VwapStore(const VwapStore&) = delete;
+        VwapStore& operator=(const VwapStore&) = delete;
+
+        size_t rows() const { return header_.rows; }
+        TimeBuckets buckets() const { return TimeBuckets{ header_.bucket_width, header_.window }; }
+
+        std::span<const StockSymbol> symbolColumn() const { return column<StockSymbol>(kSymbolColumn); }
+        std::span<const uint16_t> stockIds() const { return column<uint16_t>(kStockIdColumn); }
+        std::span<const uint32_t> bucketIds() const { return column<uint32_t>(kBucketColumn); }
+        std::span<const double> vwap() const { return column<double>(kVwapColumn); }
+        std::span<const uint64_t> volume() const { return column<uint64_t>(kVolumeColumn); }
+        std::span<const uint64_t> notional() const { return column<uint64_t>(kNotionalColumn); }
+        std::span<const double> windowVwap() const { return column<double>(kWindowVwapColumn); }
+        std::span<const uint64_t> windowVolume() const { return column<uint64_t>(kWindowVolumeColumn); }
+        std::span<const uint64_t> windowNotional() const { return column<uint64_t>(kWindowNotionalColumn); }
+
+        // Every stock with rows, in stock id order
+        std::span<const VwapStoreSymbol> symbols() const {
+            return { reinterpret_cast<const VwapStoreSymbol*>(base_ + header_.symbols_offset), header_.symbol_count };
+        }
+
+        // Row numbers of one stock in bucket order; empty if it has none
+        std::span<const uint32_t> rowsOf(uint16_t stock_id) const {
+            std::span<const VwapStoreSymbol> index = symbols();
+            auto it = std::lower_bound(index.begin(), index.end(), stock_id,
+                [](const VwapStoreSymbol& symbol, uint16_t id) { return symbol.stock_id < id; });
+            if (it == index.end() || it->stock_id != stock_id) return {};
+            return rowIndex().subspan(it->first_row, it->row_count);
+        }
+
+        VwapRow row(size_t row) const {
+            return VwapRow{ symbolColumn()[row], stockIds()[row], bucketIds()[row], volume()[row], notional()[row],
+                windowVolume()[row], windowNotional()[row] };
+        }
+
+    private:
+        bool fits(uint64_t offset, uint64_t size) const {
+            return offset % detail::kStoreAlignment == 0 && offset <= file_.size() && size <= file_.size() - offset;
+        }
+
+        template<typename T>
+        std::span<const T> column(VwapColumn column) const {
+            return { reinterpret_cast<const T*>(base_ + header_.column_offset[column]), header_.rows };
+        }
+
+        std::span<const uint32_t> rowIndex() const {
+            return { reinterpret_cast<const uint32_t*>(base_ + header_.row_index_offset), header_.rows };
+        }
+
+        MemoryMappedFileReader file_;
+        const char* base_ = nullptr;
+        VwapStoreHeader header_;
+    };
+
+    // Writes the output.csv a store was produced alongside, byte for byte, to fd
+    void writeVwapStoreCsv(const VwapStore& store, int fd) {
+        constexpr size_t kBatch = 1u << 16;
+        AsyncVwapWriter writer(fd, store.buckets());
+        for (size_t begin = 0; begin < store.rows(); begin += kBatch) {
+            std::vector<VwapRow> rows;
+            size_t end = std::min(store.rows(), begin + kBatch);
+            rows.reserve(end - begin);
+            for (size_t row = begin; row < end; ++row) {
+                rows.push_back(store.row(row));
+            }
+            writer.submit(std::move(rows));
+        }
+        writer.close();
+    }
+}
+
+#endif
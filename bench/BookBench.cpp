@@ -0,0 +1,272 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-17 01:58:22
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-17 01:58:22
+ */
+
+// Times the order book updates of a synthetic day (ItchGenerator.h) or a feed file on one core.
+// The feed is decoded up front and only the book messages (A, F, E, C, X, D, U) are replayed:
+//   OrderBook    OrderBook.h, the book a -DGUG_WITH_BOOK build keeps per shard
+//   map book     std::map price levels per side and an std::unordered_map of the live orders,
+//                the textbook book, for comparison
+// Both books see the same updates and must end with the same top of book for every stock.
+//
+//   g++ -std=c++2a -O3 -o BookBench bench/BookBench.cpp -lpthread
+//   ./BookBench [--symbols n] [--live-orders n] [--size n[M]] [--seed n] [--repeat n] [--input file]
+
+#include <sys/resource.h> // For getrusage
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+
+#include "ItchGenerator.h"
+#include "../OrderBook.h"
+#include "../Pipeline.h"
+
+using namespace GuG;
+
+namespace {
+
+    // One decoded book message
+    struct Update {
+        char type;
+        char side;
+        uint16_t stock_id;
+        uint32_t price;
+        uint32_t shares;
+        uint64_t order_id;
+        uint64_t new_order_id;
+    };
+
+    long peakRssKb() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    std::vector<Update> bookUpdates(const std::vector<std::byte>& feed) {
+        std::vector<Update> updates;
+        parseFrames(feed.data(), feed.data() + feed.size(), [&updates](ItchMessageRecord&& record) {
+            switch (messageHeader(record).message_type) {
+            case 'A': {
+                const auto& msg = std::get<AddOrderMessage>(record);
+                updates.push_back({ 'A', msg.side, msg.stock_id, msg.price, msg.shares, msg.order_id, 0 });
+                break;
+            }
+            case 'F': {
+                const auto& msg = std::get<AddOrderMPIDAttributionMessage>(record);
+                updates.push_back({ 'A', msg.side, msg.stock_id, msg.price, static_cast<uint32_t>(msg.shares), msg.order_id, 0 });
+                break;
+            }
+            case 'E': {
+                const auto& msg = std::get<OrderExecutedMessage>(record);
+                updates.push_back({ 'X', 0, msg.stock_id, 0, msg.executed_shares, msg.order_id, 0 });
+                break;
+            }
+            case 'C': {
+                const auto& msg = std::get<OrderExecutedWithPriceMessage>(record);
+                updates.push_back({ 'X', 0, msg.stock_id, 0, msg.executed_shares, msg.order_id, 0 });
+                break;
+            }
+            case 'X': {
+                const auto& msg = std::get<OrderCancelMessage>(record);
+                updates.push_back({ 'X', 0, msg.stock_id, 0, msg.cancelled_shares, msg.order_id, 0 });
+                break;
+            }
+            case 'D': {
+                const auto& msg = std::get<OrderDeleteMessage>(record);
+                updates.push_back({ 'D', 0, msg.stock_id, 0, 0, msg.order_id, 0 });
+                break;
+            }
+            case 'U': {
+                const auto& msg = std::get<OrderReplaceMessage>(record);
+                updates.push_back({ 'U', 0, msg.stock_id, msg.price, msg.shares, msg.original_order_id, msg.new_order_id });
+                break;
+            }
+            default:
+                break;
+            }
+            });
+        return updates;
+    }
+
+    // Reference book: one std::map of levels per side and stock
+    class MapBook {
+    public:
+        void add(uint16_t stock_id, uint64_t order_id, char side, uint32_t price, uint32_t shares) {
+            erase(order_id);
+            orders_[order_id] = { price, shares, stock_id, side };
+            levels(stock_id, side)[price] += shares;
+        }
+
+        void reduce(uint64_t order_id, uint32_t shares) {
+            auto it = orders_.find(order_id);
+            if (it == orders_.end()) return;
+            Order& order = it->second;
+            uint32_t taken = std::min(order.shares, shares);
+            take(order, taken);
+            order.shares -= taken;
+            if (order.shares == 0) orders_.erase(it);
+        }
+
+        void erase(uint64_t order_id) {
+            auto it = orders_.find(order_id);
+            if (it == orders_.end()) return;
+            take(it->second, it->second.shares);
+            orders_.erase(it);
+        }
+
+        void replace(uint16_t stock_id, uint64_t order_id, uint64_t new_order_id, uint32_t price, uint32_t shares) {
+            auto it = orders_.find(order_id);
+            char side = 0;
+            if (it != orders_.end()) {
+                side = it->second.side;
+                take(it->second, it->second.shares);
+                orders_.erase(it);
+            }
+            if (side != 0) add(stock_id, new_order_id, side, price, shares);
+            else orders_[new_order_id] = { price, shares, stock_id, 0 };
+        }
+
+        // Best price of the side, 0 if empty
+        uint32_t best(uint16_t stock_id, char side) {
+            auto& side_levels = levels(stock_id, side);
+            if (side_levels.empty()) return 0;
+            return side == 'S' ? side_levels.begin()->first : side_levels.rbegin()->first;
+        }
+
+    private:
+        struct Order {
+            uint32_t price;
+            uint32_t shares;
+            uint16_t stock_id;
+            char side;
+        };
+
+        std::map<uint32_t, uint64_t>& levels(uint16_t stock_id, char side) {
+            if (stock_id >= books_.size()) books_.resize(static_cast<size_t>(stock_id) + 1);
+            return side == 'S' ? books_[stock_id].second : books_[stock_id].first;
+        }
+
+        void take(const Order& order, uint32_t shares) {
+            if (order.side == 0) return;
+            auto& side_levels = levels(order.stock_id, order.side);
+            auto level = side_levels.find(order.price);
+            if (level == side_levels.end()) return;
+            level->second -= shares;
+            // a level is dropped with its last share; OrderBook counts orders, which ends the same
+            // for books where every resting order has shares
+            if (level->second == 0) side_levels.erase(level);
+        }
+
+        std::unordered_map<uint64_t, Order> orders_;
+        std::vector<std::pair<std::map<uint32_t, uint64_t>, std::map<uint32_t, uint64_t>>> books_;
+    };
+
+    template<typename Book>
+    void apply(Book& book, const Update& update) {
+        switch (update.type) {
+        case 'A': book.add(update.stock_id, update.order_id, update.side, update.price, update.shares); break;
+        case 'X': book.reduce(update.order_id, update.shares); break;
+        case 'D': book.erase(update.order_id); break;
+        case 'U': book.replace(update.stock_id, update.order_id, update.new_order_id, update.price, update.shares); break;
+        }
+    }
+
+    double seconds(const std::function<void()>& fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(const std::string& book, size_t updates, double elapsed) {
+        std::cout << std::left << std::setw(14) << book << std::right
+            << std::setw(12) << updates
+            << std::setw(10) << std::setprecision(3) << elapsed
+            << std::setw(12) << std::setprecision(2) << updates / elapsed / 1e6
+            << std::setw(10) << std::setprecision(1) << elapsed * 1e9 / updates << " ns/update"
+            << std::setw(10) << peakRssKb() / 1024 << " MB\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    GeneratorConfig config;
+    config.size = 256ull << 20;
+    std::string input;
+    int repeat = 3;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "--symbols") config.symbols = static_cast<uint32_t>(std::stoul(value));
+        else if (arg == "--live-orders") config.live_orders = static_cast<uint32_t>(std::stoul(value));
+        else if (arg == "--size") config.size = std::stoull(value) << 20;
+        else if (arg == "--seed") config.seed = std::stoull(value);
+        else if (arg == "--repeat") repeat = std::max(1, std::stoi(value));
+        else if (arg == "--input") input = value;
+        else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::byte> feed;
+    if (input.empty()) {
+        feed = ItchGenerator(config).generate();
+        std::cout << "synthetic day: " << config.symbols << " symbols, " << config.live_orders << " live orders, seed "
+            << config.seed << "\n";
+    }
+    else {
+        MemoryMappedFileReader file(input.c_str());
+        const std::byte* data = static_cast<const std::byte*>(file.data());
+        feed.assign(data, data + file.size());
+    }
+    const std::vector<Update> updates = bookUpdates(feed);
+    feed.clear();
+    feed.shrink_to_fit();
+    uint16_t last_stock = 0;
+    for (const Update& update : updates) last_stock = std::max(last_stock, update.stock_id);
+    std::cout << updates.size() << " book updates, best of " << repeat << " runs\n\n"
+        << std::left << std::setw(14) << "book" << std::right << std::setw(12) << "updates" << std::setw(10) << "seconds"
+        << std::setw(12) << "M/s" << std::setw(20) << "per update" << std::setw(10) << "peak RSS" << "\n" << std::fixed;
+
+    // Fresh books each run, sized like a shard of the default --expected-orders
+    double best = 0;
+    size_t levels = 0;
+    size_t live = 0;
+    std::vector<BookQuote> tops(static_cast<size_t>(last_stock) + 1);
+    for (int run = 0; run < repeat; ++run) {
+        OrderBook book(Options{}.expected_orders);
+        double elapsed = seconds([&] { for (const Update& update : updates) apply(book, update); });
+        best = run == 0 ? elapsed : std::min(best, elapsed);
+        if (run + 1 < repeat) continue;
+        live = book.orders();
+        levels = 0;
+        for (uint16_t stock = 0; stock <= last_stock; ++stock) {
+            levels += book.bids(stock) != nullptr ? book.bids(stock)->levels() + book.asks(stock)->levels() : 0;
+            tops[stock] = book.quote(stock, 0);
+        }
+    }
+    report("OrderBook", updates.size(), best);
+
+    MapBook map_book;
+    double elapsed = seconds([&] { for (const Update& update : updates) apply(map_book, update); });
+    report("map book", updates.size(), elapsed);
+
+    size_t mismatches = 0;
+    for (uint16_t stock = 0; stock <= last_stock; ++stock) {
+        if (map_book.best(stock, 'B') != tops[stock].bid || map_book.best(stock, 'S') != tops[stock].ask) ++mismatches;
+    }
+    std::cout << "\n" << live << " live orders on " << levels << " price levels at the end";
+    if (mismatches != 0) {
+        std::cout << ", " << mismatches << " stocks with a different top of book";
+    }
+    std::cout << "\n";
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 15:12:09
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 15:12:09
+ */
+
+// Microbenchmarks of the message decoders: the field by field scalar decoders against the
+// SSSE3 / AVX2 byte swap decoders, and the Utility.h field readers against their replacements.
+//
+//   g++ -std=c++2a -O3 -o DecoderBench bench/DecoderBench.cpp
+//   ./DecoderBench [messages per type]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <tuple>
+
+#include "../Message.h"
+
+using namespace GuG;
+
+namespace {
+
+    // The byte by byte timestamp reader Utility.h used before, kept as the baseline
+    uint64_t loopReadTimeStamp(const std::byte*& buffer) {
+        uint64_t timestamp = 0;
+        for (int i = 0; i < 6; ++i) {
+            timestamp |= (static_cast<uint64_t>(static_cast<unsigned char>(buffer[i]))) << ((5 - i) * 8);
+        }
+        buffer += 6;
+        return timestamp;
+    }
+
+    template<typename T>
+    void doNotOptimize(const T& value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    auto fields(const ItchMessage& m) { return std::tie(m.message_type, m.stock_id, m.message_time); }
+    auto fields(const StockDirectoryMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::make_tuple(std::string(m.stock_symbol.view()))); }
+    auto fields(const AddOrderMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::tie(m.order_id, m.shares, m.price)); }
+    auto fields(const AddOrderMPIDAttributionMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::tie(m.order_id, m.shares, m.price)); }
+    auto fields(const OrderExecutedMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::tie(m.order_id, m.executed_shares, m.match_number)); }
+    auto fields(const OrderExecutedWithPriceMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::tie(m.order_id, m.executed_shares, m.printable, m.execution_price, m.match_number)); }
+    auto fields(const OrderCancelMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::tie(m.order_id, m.cancelled_shares)); }
+    auto fields(const OrderDeleteMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::tie(m.order_id)); }
+    auto fields(const OrderReplaceMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::tie(m.original_order_id, m.new_order_id, m.shares, m.price)); }
+    auto fields(const NonCrossTradeMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::tie(m.order_id, m.shares, m.price, m.match_number)); }
+    auto fields(const CrossTradeMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::tie(m.shares, m.cross_price, m.match_number)); }
+    auto fields(const BrokenTradeMessage& m) { return std::tuple_cat(fields(static_cast<const ItchMessage&>(m)), std::tie(m.match_number)); }
+
+    bool sameFields(const ItchMessageRecord& a, const ItchMessageRecord& b) {
+        if (a.index() != b.index()) return false;
+        return std::visit([&b](const auto& message) {
+            using Message = std::decay_t<decltype(message)>;
+            return fields(message) == fields(std::get<Message>(b));
+            }, a);
+    }
+
+    // Random message bodies of one type, padded symbols included
+    std::vector<std::byte> makeBodies(char msg_type, size_t count, std::mt19937_64& rng) {
+        size_t size = MessageFactory::getMessageSize(msg_type);
+        std::vector<std::byte> bodies(size * count);
+        for (auto& b : bodies) b = static_cast<std::byte>(rng());
+        for (size_t i = 0; i < count; ++i) {
+            std::byte* body = bodies.data() + i * size;
+            size_t symbol_offset = msg_type == 'R' ? 10 : msg_type == 'Q' ? 18 : 23;
+            if (msg_type == 'R' || msg_type == 'A' || msg_type == 'F' || msg_type == 'P' || msg_type == 'Q') {
+                size_t length = 1 + rng() % 8;
+                for (size_t j = 0; j < 8; ++j) {
+                    body[symbol_offset + j] = static_cast<std::byte>(j < length ? 'A' + rng() % 26 : ' ');
+                }
+            }
+            if (msg_type == 'C') body[30] = static_cast<std::byte>(rng() % 2 ? 'Y' : 'N');
+        }
+        return bodies;
+    }
+
+    template<typename Fn>
+    double nsPerOp(size_t ops, int repeats, Fn&& fn) {
+        double best = 1e300;
+        for (int r = 0; r < repeats; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count() / ops);
+        }
+        return best;
+    }
+
+    double decodeAll(MessageDecoder decode, const std::vector<std::byte>& bodies, size_t count, int repeats) {
+        ItchMessageRecord record;
+        return nsPerOp(count, repeats, [&] {
+            const std::byte* data = bodies.data();
+            for (size_t i = 0; i < count; ++i) {
+                decode(data, record);
+                doNotOptimize(record);
+            }
+            });
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t count = argc > 1 ? std::stoull(argv[1]) : 1000000;
+    const int repeats = 5;
+    const SimdLevel cpu = detectSimdLevel();
+    std::mt19937_64 rng(42);
+
+    MessageDecoderTable scalar = makeMessageDecoders(SimdLevel::Scalar);
+    MessageDecoderTable ssse3 = makeMessageDecoders(cpu >= SimdLevel::Ssse3 ? SimdLevel::Ssse3 : SimdLevel::Scalar);
+    MessageDecoderTable avx2 = makeMessageDecoders(cpu >= SimdLevel::Avx2 ? SimdLevel::Avx2 : SimdLevel::Scalar);
+
+    std::cout << "CPU decoder level: " << simdLevelName(cpu) << ", " << count << " messages per type, ns/message\n";
+    std::cout << std::left << std::setw(6) << "type" << std::setw(10) << "scalar" << std::setw(10) << "ssse3"
+        << std::setw(10) << "avx2" << "check\n" << std::fixed << std::setprecision(2);
+
+    for (char msg_type : { 'R', 'A', 'F', 'E', 'C', 'X', 'D', 'U', 'P', 'Q', 'B' }) {
+        auto bodies = makeBodies(msg_type, count, rng);
+        unsigned char index = static_cast<unsigned char>(msg_type);
+
+        bool same = true;
+        for (size_t i = 0; i < std::min<size_t>(count, 10000) && same; ++i) {
+            ItchMessageRecord expected, simd, wide;
+            const std::byte* a = bodies.data() + i * MessageFactory::getMessageSize(msg_type);
+            const std::byte* b = a;
+            const std::byte* c = a;
+            scalar[index](a, expected);
+            ssse3[index](b, simd);
+            avx2[index](c, wide);
+            same = sameFields(expected, simd) && sameFields(expected, wide) && a == b && a == c;
+        }
+
+        std::cout << std::setw(6) << msg_type
+            << std::setw(10) << decodeAll(scalar[index], bodies, count, repeats)
+            << std::setw(10) << decodeAll(ssse3[index], bodies, count, repeats)
+            << std::setw(10) << decodeAll(avx2[index], bodies, count, repeats)
+            << (same ? "ok" : "MISMATCH") << "\n";
+    }
+
+    // Field readers on the stock symbol and timestamp of Add Order bodies
+    auto bodies = makeBodies('A', count, rng);
+    const size_t size = MessageFactory::getMessageSize('A');
+    auto symbols = [&](auto&& reader) {
+        return nsPerOp(count, repeats, [&] {
+            for (size_t i = 0; i < count; ++i) {
+                const std::byte* data = bodies.data() + i * size + 23;
+                doNotOptimize(reader(data));
+            }
+            });
+    };
+    auto timestamps = [&](auto&& reader) {
+        return nsPerOp(count, repeats, [&] {
+            for (size_t i = 0; i < count; ++i) {
+                const std::byte* data = bodies.data() + i * size + 4;
+                doNotOptimize(reader(data));
+            }
+            });
+    };
+    bool same_symbols = true;
+    bool same_timestamps = true;
+    for (size_t i = 0; i < count; ++i) {
+        const std::byte* a = bodies.data() + i * size + 23;
+        const std::byte* b = a;
+        same_symbols &= readStock(a) == readStockSymbol(b).view();
+        const std::byte* c = bodies.data() + i * size + 4;
+        const std::byte* d = c;
+        same_timestamps &= loopReadTimeStamp(c) == readTimeStamp(d);
+    }
+
+    std::cout << "\nfield readers, ns/call\n"
+        << std::setw(34) << "readStock (std::string, isspace)" << symbols([](const std::byte*& p) { return readStock(p).size(); }) << "\n"
+        << std::setw(34) << "readStockSymbol (8-byte mask)" << symbols([](const std::byte*& p) { return readStockSymbol(p).value[0]; })
+        << (same_symbols ? "  ok" : "  MISMATCH") << "\n"
+        << std::setw(34) << "byte loop timestamp" << timestamps(loopReadTimeStamp) << "\n"
+        << std::setw(34) << "readTimeStamp (2 + 4 byte words)" << timestamps([](const std::byte*& p) { return readTimeStamp(p); })
+        << (same_timestamps ? "  ok" : "  MISMATCH") << "\n";
+    return 0;
+}
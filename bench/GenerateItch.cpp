@@ -0,0 +1,77 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 21:08:40
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 21:08:40
+ */
+
+// Writes a deterministic synthetic ITCH 5.0 day, see ItchGenerator.h.
+//
+//   g++ -std=c++2a -O3 -o GenerateItch bench/GenerateItch.cpp
+//   ./GenerateItch [--symbols n] [--live-orders n] [--trade-rate r] [--size n[K|M|G]] [--seed n] out.itch
+//
+// Pass - as the output to write to stdout.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+
+#include "ItchGenerator.h"
+
+using namespace GuG;
+
+namespace {
+
+    uint64_t parseSize(const std::string& value) {
+        size_t pos = 0;
+        uint64_t size = std::stoull(value, &pos);
+        std::string unit = value.substr(pos);
+        if (unit == "K") size <<= 10;
+        else if (unit == "M") size <<= 20;
+        else if (unit == "G") size <<= 30;
+        else if (!unit.empty()) throw std::invalid_argument("Invalid size: " + value);
+        return size;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    GeneratorConfig config;
+    std::string output;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--symbols") config.symbols = static_cast<uint32_t>(std::stoul(value()));
+            else if (arg == "--live-orders") config.live_orders = static_cast<uint32_t>(std::stoul(value()));
+            else if (arg == "--trade-rate") config.trade_ppm = static_cast<uint32_t>(std::stod(value()) * 1000000 + 0.5);
+            else if (arg == "--size") config.size = parseSize(value());
+            else if (arg == "--seed") config.seed = std::stoull(value());
+            else if (output.empty() && (arg == "-" || arg[0] != '-')) output = arg;
+            else throw std::invalid_argument("Unexpected argument: " + arg);
+        }
+        if (output.empty()) throw std::invalid_argument("Missing output file");
+
+        ItchGenerator generator(config);
+        std::ofstream file;
+        if (output != "-") {
+            file.open(output, std::ios::out | std::ios::trunc | std::ios::binary);
+            if (!file.is_open()) throw std::runtime_error("Failed to open " + output);
+        }
+        std::ostream& out = output == "-" ? std::cout : file;
+        generator.run([&out](const std::byte* data, size_t size) {
+            out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+            });
+        if (!out.flush()) throw std::runtime_error("Error writing " + output);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n"
+            << "Usage: " << argv[0] << " [--symbols n] [--live-orders n] [--trade-rate r] [--size n[K|M|G]] [--seed n] out.itch\n";
+        return 1;
+    }
+    return 0;
+}
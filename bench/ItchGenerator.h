@@ -0,0 +1,308 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 20:55:03
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 20:55:03
+ */
+
+#ifndef ITCH_GENERATOR_H
+#define ITCH_GENERATOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+#include "../Message.h"
+
+namespace GuG {
+
+    // Shape of a synthetic trading day
+    struct GeneratorConfig {
+        uint32_t symbols = 8000;            // stock locates 1..symbols, a few of them very active
+        uint32_t live_orders = 200000;      // resting orders the book is kept around
+        uint32_t trade_ppm = 60000;         // trades (E, C, P, Q) per million messages
+        uint64_t size = 256ull << 20;       // bytes of frames to write
+        uint64_t seed = 1;
+    };
+
+    // Deterministic ITCH 5.0 writer: the same config gives the same bytes on any machine, since
+    // the generator only uses its own integer RNG. The day opens with a Start of Messages event
+    // and a directory entry per symbol, then mixes the message types of Message.h roughly like a
+    // NASDAQ day (adds and deletes dominate, executions follow trade_ppm, crosses and broken
+    // trades are rare) with timestamps spread from 04:00 to 20:00, and ends with End of Messages.
+    class ItchGenerator {
+    public:
+        explicit ItchGenerator(const GeneratorConfig& config) : config_(config), state_(config.seed) {
+            if (config.symbols == 0 || config.symbols > 65535) {
+                throw std::invalid_argument("symbols must be between 1 and 65535");
+            }
+            if (config.trade_ppm > 1000000) {
+                throw std::invalid_argument("trade rate must be at most 1");
+            }
+        }
+
+        // Calls write(data, size) with consecutive pieces of the feed
+        template<typename Write>
+        void run(Write&& write) {
+            constexpr uint64_t kOpen = 4 * kNanosPerHour;
+            constexpr uint64_t kClose = 20 * kNanosPerHour;
+            time_ = kOpen;
+            written_ = 0;
+            systemEvent('O');
+            for (uint32_t locate = 1; locate <= config_.symbols; ++locate) {
+                directory(locate);
+            }
+            flush(write);
+            while (written_ < config_.size) {
+                time_ = kOpen + static_cast<uint64_t>(static_cast<unsigned __int128>(kClose - kOpen) * written_ / config_.size);
+                nextMessage();
+                if (out_.size() >= kFlushSize) {
+                    flush(write);
+                }
+            }
+            systemEvent('C');
+            flush(write);
+        }
+
+        std::vector<std::byte> generate() {
+            std::vector<std::byte> feed;
+            feed.reserve(config_.size + (1u << 20));
+            run([&feed](const std::byte* data, size_t size) { feed.insert(feed.end(), data, data + size); });
+            return feed;
+        }
+
+    private:
+        static constexpr size_t kFlushSize = 1u << 20;
+
+        struct Order {
+            uint64_t id;
+            uint16_t locate;
+            uint32_t shares;
+            uint32_t price;
+        };
+
+        uint64_t next() {  // splitmix64
+            uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        uint64_t below(uint64_t bound) { return static_cast<uint64_t>(static_cast<unsigned __int128>(next()) * bound >> 64); }
+
+        // Square of a uniform draw: low locates trade far more often than high ones
+        uint16_t pickSymbol() {
+            uint64_t u = next() >> 32;
+            return static_cast<uint16_t>(1 + ((u * u) >> 32) * config_.symbols / (1ull << 32));
+        }
+
+        uint32_t priceNear(uint16_t locate) {
+            uint32_t mid = 10000 + static_cast<uint32_t>((locate * 2654435761u) % 5000000);  // $1 to $501
+            return mid - 500 + static_cast<uint32_t>(below(1001));
+        }
+
+        uint32_t lot() { return below(8) == 0 ? 1 + static_cast<uint32_t>(below(99)) : 100 * (1 + static_cast<uint32_t>(below(10))); }
+
+        void nextMessage() {
+            if (below(1000000) < config_.trade_ppm) {
+                trade();
+            }
+            else if (live_.size() < config_.live_orders || live_.empty()) {
+                addOrder();
+            }
+            else {
+                uint64_t r = below(100);
+                if (r < 50) addOrder();
+                else if (r < 85) deleteOrder();
+                else if (r < 93) cancelOrder();
+                else replaceOrder();
+            }
+        }
+
+        void trade() {
+            uint64_t r = below(1000);
+            if (r < 2 && !matches_.empty()) {
+                // break one of the last trades
+                const Match& broken = matches_[below(matches_.size())];
+                header('B', broken.locate);
+                put64(broken.match);
+            }
+            else if (r < 20) {
+                uint16_t locate = pickSymbol();
+                header('Q', locate);
+                put64(1000 * (1 + below(500)));
+                putSymbol(locate);
+                put32(priceNear(locate));
+                put64(recordMatch(locate));
+                putChar(below(2) ? 'O' : 'C');
+            }
+            else if (r < 150 || live_.empty()) {
+                uint16_t locate = pickSymbol();
+                header('P', locate);
+                put64(0);
+                putChar(below(2) ? 'B' : 'S');
+                put32(lot());
+                putSymbol(locate);
+                put32(priceNear(locate));
+                put64(recordMatch(locate));
+            }
+            else {
+                size_t index = below(live_.size());
+                Order& order = live_[index];
+                uint32_t shares = std::min(order.shares, lot());
+                bool with_price = r >= 900;
+                header(with_price ? 'C' : 'E', order.locate);
+                put64(order.id);
+                put32(shares);
+                put64(recordMatch(order.locate));
+                if (with_price) {
+                    putChar(below(20) == 0 ? 'N' : 'Y');
+                    put32(order.price + static_cast<uint32_t>(below(3)) - 1);
+                }
+                order.shares -= shares;
+                if (order.shares == 0) removeLive(index);
+            }
+        }
+
+        void addOrder() {
+            uint16_t locate = pickSymbol();
+            Order order{ next_order_id_++, locate, lot(), priceNear(locate) };
+            bool attributed = below(10) == 0;
+            header(attributed ? 'F' : 'A', locate);
+            put64(order.id);
+            putChar(below(2) ? 'B' : 'S');
+            put32(order.shares);
+            putSymbol(locate);
+            put32(order.price);
+            if (attributed) putBytes("GUGX", 4);
+            live_.push_back(order);
+        }
+
+        void deleteOrder() {
+            size_t index = below(live_.size());
+            header('D', live_[index].locate);
+            put64(live_[index].id);
+            removeLive(index);
+        }
+
+        void cancelOrder() {
+            size_t index = below(live_.size());
+            Order& order = live_[index];
+            uint32_t shares = 1 + static_cast<uint32_t>(below(order.shares));
+            header('X', order.locate);
+            put64(order.id);
+            put32(shares);
+            order.shares -= shares;
+            if (order.shares == 0) removeLive(index);
+        }
+
+        void replaceOrder() {
+            size_t index = below(live_.size());
+            Order& order = live_[index];
+            header('U', order.locate);
+            put64(order.id);
+            order.id = next_order_id_++;
+            order.shares = lot();
+            order.price = priceNear(order.locate);
+            put64(order.id);
+            put32(order.shares);
+            put32(order.price);
+        }
+
+        void removeLive(size_t index) {
+            live_[index] = live_.back();
+            live_.pop_back();
+        }
+
+        uint64_t recordMatch(uint16_t locate) {
+            uint64_t match = next_match_++;
+            if (matches_.size() < kRecentMatches) matches_.push_back({ locate, match });
+            else matches_[match % kRecentMatches] = { locate, match };
+            return match;
+        }
+
+        void systemEvent(char code) {
+            header('S', 0);
+            putChar(code);
+        }
+
+        void directory(uint16_t locate) {
+            header('R', locate);
+            putSymbol(locate);
+            putBytes("QN", 2);
+            put32(100);
+            putBytes("NCZ PN 1N", 9);
+            put32(0);
+            putChar('N');
+        }
+
+        // Starts a frame: the length is filled in when the next frame starts or on flush
+        void header(char type, uint16_t locate) {
+            closeFrame();
+            frame_start_ = out_.size();
+            put16(0);
+            putChar(type);
+            put16(locate);
+            put16(0);
+            for (int shift = 40; shift >= 0; shift -= 8) putChar(static_cast<char>(time_ >> shift));
+        }
+
+        void closeFrame() {
+            if (frame_start_ == kNoFrame) return;
+            size_t length = out_.size() - frame_start_ - 2;
+            char type = static_cast<char>(out_[frame_start_ + 2]);
+            if (!hasSpecLength(type, length)) {
+                throw std::logic_error(std::string("Generated a malformed ") + type + " message");
+            }
+            out_[frame_start_] = static_cast<std::byte>(length >> 8);
+            out_[frame_start_ + 1] = static_cast<std::byte>(length);
+            written_ += length + 2;
+            frame_start_ = kNoFrame;
+        }
+
+        template<typename Write>
+        void flush(Write& write) {
+            closeFrame();
+            write(out_.data(), out_.size());
+            out_.clear();
+        }
+
+        void putChar(char c) { out_.push_back(static_cast<std::byte>(c)); }
+        void putBytes(const char* data, size_t size) { for (size_t i = 0; i < size; ++i) putChar(data[i]); }
+        void put16(uint16_t value) { putChar(static_cast<char>(value >> 8)); putChar(static_cast<char>(value)); }
+        void put32(uint32_t value) { put16(static_cast<uint16_t>(value >> 16)); put16(static_cast<uint16_t>(value)); }
+        void put64(uint64_t value) { put32(static_cast<uint32_t>(value >> 32)); put32(static_cast<uint32_t>(value)); }
+
+        // "S" + locate, space padded to 8 bytes
+        void putSymbol(uint16_t locate) {
+            char symbol[9];
+            std::snprintf(symbol, sizeof(symbol), "S%-7u", static_cast<unsigned>(locate));
+            putBytes(symbol, 8);
+        }
+
+        struct Match {
+            uint16_t locate;
+            uint64_t match;
+        };
+
+        static constexpr size_t kRecentMatches = 64;
+        static constexpr size_t kNoFrame = SIZE_MAX;
+
+        const GeneratorConfig config_;
+        uint64_t state_;
+        uint64_t time_ = 0;
+        uint64_t written_ = 0;
+        uint64_t next_order_id_ = 1;
+        uint64_t next_match_ = 1;
+        std::vector<Order> live_;
+        std::vector<Match> matches_;
+        std::vector<std::byte> out_;
+        size_t frame_start_ = kNoFrame;
+    };
+}
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 23:31:52
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 23:31:52
+ */
+
+// Compares the input backends of --reader on one feed file, with the file's pages dropped from
+// the page cache (cold) and after a full read (warm):
+//   scan       every frame header walked, nothing decoded: the reader's own throughput
+//   pipeline   runPipeline end to end with the default options, output to /dev/null
+// Every run is a forked child, so the peak RSS reported is that run's alone.
+//
+//   g++ -std=c++2a -O3 -o ReaderBench bench/ReaderBench.cpp -lpthread
+//   ./ReaderBench [--read-block n[K|M]] [--read-ahead n] [--warm-only] itchDatafile
+//
+// Cold runs drop the file with posix_fadvise(POSIX_FADV_DONTNEED), which only evicts clean
+// pages nobody else has mapped; run it on a file nothing else is reading.
+
+#include <sys/resource.h> // For rusage
+#include <sys/wait.h>     // For wait4
+#include <fcntl.h>        // For open, posix_fadvise
+#include <unistd.h>       // For fork, pipe
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "../Pipeline.h"
+
+using namespace GuG;
+
+namespace {
+
+    struct Backend {
+        const char* name;
+        InputBackend kind;
+    };
+
+    constexpr Backend kBackends[] = {
+        { "mmap", InputBackend::Mmap },
+        { "mmap-window", InputBackend::MmapWindow },
+        { "pread", InputBackend::Pread },
+        { "direct", InputBackend::Direct },
+        { "io_uring", InputBackend::Uring },
+    };
+
+    // Walks the frames of [begin, end); returns the start of the incomplete frame at the end
+    const std::byte* scanFrames(const std::byte* begin, const std::byte* end, uint64_t& frames) {
+        const std::byte* frame = begin;
+        while (static_cast<size_t>(end - frame) >= kFrameHeaderSize) {
+            size_t length = frameLength(frame);
+            if (static_cast<size_t>(end - frame) - kFrameHeaderSize < length) break;
+            frame += kFrameHeaderSize + length;
+            ++frames;
+        }
+        return frame;
+    }
+
+    void evict(const char* path) {
+        int fd = open(path, O_RDONLY);
+        if (fd == -1) return;
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+
+    // One pass with the backend, in this process
+    uint64_t scan(const Options& options) {
+        uint64_t frames = 0;
+        if (options.input_backend == InputBackend::Mmap || options.input_backend == InputBackend::MmapWindow) {
+            MemoryMappedFileReader reader(options.file_path);
+            const std::byte* begin = static_cast<const std::byte*>(reader.data());
+            const std::byte* end = begin + reader.size();
+            const bool windowed = options.input_backend == InputBackend::MmapWindow;
+            if (windowed) reader.adviseSequential();
+            for (const std::byte* slice = begin; slice < end;) {
+                const std::byte* slice_end = std::min(end, slice + options.read_block);
+                const std::byte* next = scanFrames(slice, slice_end, frames);
+                if (next == slice) break;
+                slice = next;
+                if (windowed) {
+                    reader.release(slice - begin);
+                    reader.prefetch(slice - begin, options.read_ahead * options.read_block);
+                }
+            }
+        }
+        else {
+            ReadBackend backend = options.input_backend == InputBackend::Pread ? ReadBackend::Pread
+                : options.input_backend == InputBackend::Direct ? ReadBackend::Direct : ReadBackend::Uring;
+            FileBlockReader reader(options.file_path, backend, options.read_block, options.read_ahead + 1);
+            reader.run([&frames](const std::byte* begin, const std::byte* end) { return scanFrames(begin, end, frames); });
+        }
+        return frames;
+    }
+
+    void pipeline(const Options& options) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        AsyncVwapWriter writer(null_fd, options.buckets);
+        PipelineMetrics metrics(options.threads, std::chrono::seconds(1));
+        std::cout.rdbuf(nullptr);  // progress lines
+        if (options.input_backend == InputBackend::Mmap || options.input_backend == InputBackend::MmapWindow) {
+            MemoryMappedFileReader reader(options.file_path);
+            runPipeline(reader, options, writer, metrics);
+        }
+        else {
+            ReadBackend backend = options.input_backend == InputBackend::Pread ? ReadBackend::Pread
+                : options.input_backend == InputBackend::Direct ? ReadBackend::Direct : ReadBackend::Uring;
+            FileBlockReader reader(options.file_path, backend, options.read_block, options.read_ahead + 1);
+            runPipeline(reader, options, writer, metrics);
+        }
+        writer.close();
+        close(null_fd);
+    }
+
+    struct Measurement {
+        bool ok = false;
+        double seconds = 0;
+        long peak_rss_kb = 0;
+    };
+
+    // Runs fn in a child process; the child reports its own elapsed time through a pipe
+    Measurement measure(const std::function<void()>& fn) {
+        int fds[2];
+        if (pipe(fds) == -1) return {};
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            double seconds = -1;
+            try {
+                auto start = std::chrono::steady_clock::now();
+                fn();
+                seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            catch (const std::exception& e) {
+                std::cerr << e.what() << "\n";
+            }
+            ssize_t written = write(fds[1], &seconds, sizeof(seconds));
+            _exit(written == sizeof(seconds) && seconds >= 0 ? 0 : 1);
+        }
+        close(fds[1]);
+        Measurement measurement;
+        if (pid == -1) {
+            close(fds[0]);
+            return measurement;
+        }
+        ssize_t got = read(fds[0], &measurement.seconds, sizeof(measurement.seconds));
+        close(fds[0]);
+        int status = 0;
+        rusage usage{};
+        wait4(pid, &status, 0, &usage);
+        measurement.ok = got == sizeof(measurement.seconds) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        measurement.peak_rss_kb = usage.ru_maxrss;
+        return measurement;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    bool warm_only = false;
+    std::string path;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--read-block") options.read_block = parseSize(arg, value());
+            else if (arg == "--read-ahead") options.read_ahead = parseUnsigned(arg, value());
+            else if (arg == "--warm-only") warm_only = true;
+            else if (path.empty() && arg[0] != '-') path = arg;
+            else throw std::invalid_argument("Unexpected argument: " + arg);
+        }
+        if (path.empty()) throw std::invalid_argument("Missing itchDatafile");
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n"
+            << "Usage: " << argv[0] << " [--read-block n[K|M]] [--read-ahead n] [--warm-only] itchDatafile\n";
+        return 1;
+    }
+    options.file_path = path.c_str();
+    size_t size = 0;
+    {
+        MemoryMappedFileReader file(options.file_path);
+        size = file.size();
+    }
+    std::cout << path << ": " << size / (1u << 20) << " MB, read blocks of " << options.read_block / 1024 << " KB, "
+        << options.read_ahead << " ahead\n\n"
+        << std::left << std::setw(13) << "backend" << std::setw(10) << "run" << std::setw(7) << "cache" << std::right
+        << std::setw(10) << "seconds" << std::setw(10) << "MB/s" << std::setw(12) << "peak RSS" << "\n" << std::fixed;
+
+    for (const char* run : { "scan", "pipeline" }) {
+        for (const Backend& backend : kBackends) {
+            options.input_backend = backend.kind;
+            for (bool cold : { true, false }) {
+                if (cold && warm_only) continue;
+                if (cold) evict(options.file_path);
+                else measure([&options] { scan(options); });  // warm the page cache
+                Measurement result = std::string(run) == "scan"
+                    ? measure([&options] { scan(options); })
+                    : measure([&options] { pipeline(options); });
+                std::cout << std::left << std::setw(13) << backend.name << std::setw(10) << run << std::setw(7)
+                    << (cold ? "cold" : "warm") << std::right;
+                if (!result.ok) {
+                    std::cout << std::setw(10) << "failed" << "\n";
+                    continue;
+                }
+                std::cout << std::setw(10) << std::setprecision(3) << result.seconds
+                    << std::setw(10) << std::setprecision(0) << size / result.seconds / (1u << 20)
+                    << std::setw(9) << result.peak_rss_kb / 1024 << " MB\n";
+            }
+        }
+    }
+    return 0;
+}
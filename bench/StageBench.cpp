@@ -0,0 +1,279 @@
+/*
+ * @Author: Tairan Gao
+ * @Date:   2026-10-16 21:20:12
+ * @Last Modified by:   Tairan Gao
+ * @Last Modified time: 2026-10-16 21:20:12
+ */
+
+// Times each stage of the VWAP job separately on a synthetic day (ItchGenerator.h) or a feed file:
+//   parse      readDataIntoQueue: framing, decoding and routing into one unbounded queue
+//   handoff    the decoded records through ThreadSafeQueue and SpscRingBuffer, reader to processor
+//   aggregate  processMessage draining the parse stage's queue, output to /dev/null
+//   prefetch   processMessage again on the decoded records for each --prefetch-batch in
+//              kPrefetchBatches, in cycles per message against no prefetching
+//   output     calcAndOutputVWAP on every symbol for a day of 1 minute buckets
+//   pipeline   runPipeline end to end with the default options
+// Peak RSS is the process peak after the stage, so it only grows from one stage to the next.
+//
+//   g++ -std=c++2a -O3 -o StageBench bench/StageBench.cpp -lpthread
+//   ./StageBench [--symbols n] [--live-orders n] [--trade-rate r] [--size n[M]] [--seed n] [--input file]
+//
+// The decoded feed is held in memory twice, so keep workloads to a few hundred MB.
+
+#include <sys/resource.h> // For getrusage
+#include <fcntl.h>        // For open
+#include <unistd.h>       // For write, close, unlink
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+
+#include "ItchGenerator.h"
+#include "../Pipeline.h"
+
+using namespace GuG;
+
+namespace {
+
+    long peakRssKb() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    template<typename Fn>
+    double seconds(Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void report(const std::string& stage, size_t messages, double elapsed, const std::string& unit = "msg") {
+        std::cout << std::left << std::setw(22) << stage << std::right
+            << std::setw(12) << messages
+            << std::setw(10) << std::setprecision(3) << elapsed
+            << std::setw(12) << std::setprecision(2) << messages / elapsed / 1e6
+            << std::setw(10) << std::setprecision(1) << elapsed * 1e9 / messages << " ns/" << unit
+            << std::setw(10) << peakRssKb() / 1024 << " MB\n";
+    }
+
+    // The pipeline's progress lines would drown the report: std::cout without a buffer drops them
+    class QuietStdout {
+    public:
+        QuietStdout() : saved_(std::cout.rdbuf(nullptr)) {}
+        ~QuietStdout() { restore(); }
+
+        void restore() {
+            if (saved_ != nullptr) {
+                std::cout.rdbuf(saved_);  // also clears the badbit
+                saved_ = nullptr;
+            }
+        }
+
+    private:
+        std::streambuf* saved_;
+    };
+
+    size_t countFrames(const std::vector<std::byte>& feed) {
+        size_t frames = 0;
+        for (size_t offset = 0; offset + 2 <= feed.size(); ++frames) {
+            offset += 2 + (static_cast<size_t>(feed[offset]) << 8 | static_cast<size_t>(feed[offset + 1]));
+        }
+        return frames;
+    }
+
+    constexpr size_t kPrefetchBatches[] = { 0, 4, 8, 16, 32, 64 };
+
+    // processMessage over a queue holding records, with options' prefetch batch; returns cycles
+    uint64_t aggregateCycles(const std::vector<ItchMessageRecord>& records, const Options& options, int null_fd) {
+        ThreadSafeQueue<ItchMessageRecord> queue;
+        std::array<ItchMessageRecord, kQueueBatchSize> batch;
+        for (size_t begin = 0; begin < records.size(); begin += batch.size()) {
+            size_t count = std::min(batch.size(), records.size() - begin);
+            std::copy_n(records.begin() + begin, count, batch.begin());
+            queue.pushBatch(batch.data(), count);
+        }
+        queue.finish();
+        AsyncVwapWriter writer(null_fd, options.buckets);
+        BucketMerger merger(1, options.buckets, writer);
+        PipelineMetrics metrics(1, std::chrono::seconds(1));
+        QuietStdout quiet;
+        uint64_t start = readCycles();
+        processMessage(queue, options, merger, nullptr, metrics.shard(0));
+        uint64_t cycles = readCycles() - start;
+        writer.close();
+        return cycles;
+    }
+
+    template<typename Queue, typename... QueueArgs>
+    double handoff(const std::vector<ItchMessageRecord>& records, QueueArgs... queue_args) {
+        Queue queue(queue_args...);
+        return seconds([&] {
+            std::thread producer([&] {
+                std::array<ItchMessageRecord, kQueueBatchSize> batch;
+                for (size_t begin = 0; begin < records.size(); begin += batch.size()) {
+                    size_t count = std::min(batch.size(), records.size() - begin);
+                    std::copy_n(records.begin() + begin, count, batch.begin());
+                    queue.pushBatch(batch.data(), count);
+                }
+                queue.finish();
+                });
+            std::array<ItchMessageRecord, kQueueBatchSize> batch;
+            size_t received = 0;
+            while (size_t count = queue.popBatch(batch.data(), batch.size())) {
+                received += count;
+            }
+            producer.join();
+            if (received != records.size()) {
+                std::cerr << "handoff lost messages\n";
+            }
+            });
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    GeneratorConfig config;
+    config.size = 64ull << 20;
+    std::string input;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "--symbols") config.symbols = static_cast<uint32_t>(std::stoul(value));
+        else if (arg == "--live-orders") config.live_orders = static_cast<uint32_t>(std::stoul(value));
+        else if (arg == "--trade-rate") config.trade_ppm = static_cast<uint32_t>(std::stod(value) * 1000000 + 0.5);
+        else if (arg == "--size") config.size = std::stoull(value) << 20;
+        else if (arg == "--seed") config.seed = std::stoull(value);
+        else if (arg == "--input") input = value;
+        else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    // Stages read the feed through the same mapped file reader as the real job
+    std::vector<std::byte> feed;
+    std::string path = input;
+    if (input.empty()) {
+        feed = ItchGenerator(config).generate();
+        char temp_path[] = "/tmp/stage_bench_XXXXXX";
+        int fd = mkstemp(temp_path);
+        if (fd == -1 || !detail::writeAll(fd, reinterpret_cast<const char*>(feed.data()), feed.size())) {
+            std::cerr << "Failed to write the workload\n";
+            return 1;
+        }
+        close(fd);
+        path = temp_path;
+        std::cout << "synthetic day: " << config.symbols << " symbols, " << config.live_orders << " live orders, "
+            << config.trade_ppm / 1e4 << "% trades, seed " << config.seed << "\n";
+    }
+    else {
+        MemoryMappedFileReader file(input.c_str());
+        const std::byte* data = static_cast<const std::byte*>(file.data());
+        feed.assign(data, data + file.size());
+    }
+    const size_t frames = countFrames(feed);
+    std::cout << feed.size() / (1u << 20) << " MB, " << frames << " messages\n\n"
+        << std::left << std::setw(22) << "stage" << std::right << std::setw(12) << "items" << std::setw(10) << "seconds"
+        << std::setw(12) << "M/s" << std::setw(16) << "per item" << std::setw(10) << "peak RSS" << "\n" << std::fixed;
+
+    Options options;
+    options.file_path = path.c_str();
+    int null_fd = open("/dev/null", O_WRONLY);
+    PipelineMetrics metrics(1, std::chrono::seconds(1));
+
+    // parse: readDataIntoQueue into one unbounded queue, which aggregate then drains
+    std::vector<std::unique_ptr<ThreadSafeQueue<ItchMessageRecord>>> queues;
+    queues.push_back(std::make_unique<ThreadSafeQueue<ItchMessageRecord>>());
+    {
+        MemoryMappedFileReader reader(path.c_str());
+        QuietStdout quiet;
+        double elapsed = seconds([&] { readDataIntoQueue(reader, queues, options, metrics); });
+        quiet.restore();
+        report("parse", frames, elapsed);
+    }
+
+    // handoff: the decoded records, copied out of the parser once
+    std::vector<ItchMessageRecord> records;
+    parseFrames(feed.data(), feed.data() + feed.size(),
+        [&records](ItchMessageRecord&& record) { records.push_back(std::move(record)); },
+        makeMessageFilter(options), options.buckets.width);
+    report("handoff mutex queue", records.size(), handoff<ThreadSafeQueue<ItchMessageRecord>>(records));
+    report("handoff spsc ring", records.size(), handoff<SpscRingBuffer<ItchMessageRecord>>(records, options.queue_capacity));
+
+    // aggregate: one shard over everything the parse stage queued
+    {
+        AsyncVwapWriter writer(null_fd, options.buckets);
+        BucketMerger merger(1, options.buckets, writer);
+        QuietStdout quiet;
+        double elapsed = seconds([&] { processMessage(*queues[0], options, merger, nullptr, metrics.shard(0)); });
+        writer.close();
+        quiet.restore();
+        report("aggregate", frames, elapsed);
+    }
+    queues.clear();
+
+    // prefetch: the same records through processMessage with each prefetch batch, best of three
+    std::vector<std::pair<size_t, uint64_t>> prefetch_runs;
+    for (size_t prefetch_batch : kPrefetchBatches) {
+        Options run_options = options;
+        run_options.prefetch_batch = prefetch_batch;
+        uint64_t best = UINT64_MAX;
+        for (int run = 0; run < 3; ++run) best = std::min(best, aggregateCycles(records, run_options, null_fd));
+        prefetch_runs.emplace_back(prefetch_batch, best);
+    }
+    records.clear();
+    records.shrink_to_fit();
+
+    // output: every symbol trades in every 1 minute bucket of the day
+    {
+        TimeBuckets minutes{ 60000000000ULL, 0 };
+        AsyncVwapWriter writer(null_fd, minutes);
+        BucketMerger merger(1, minutes, writer);
+        SymbolTable symbol_table;
+        for (uint32_t locate = 1; locate <= config.symbols; ++locate) {
+            StockSymbol symbol;
+            std::snprintf(symbol.value, sizeof(symbol.value), "S%u", locate);
+            symbol_table.addStock(static_cast<uint16_t>(locate), symbol);
+        }
+        QuietStdout quiet;
+        double elapsed = 0;
+        for (uint32_t bucket = 0; bucket < minutes.perDay(); ++bucket) {
+            for (uint32_t locate = 1; locate <= config.symbols; ++locate) {
+                symbol_table.addTrade(static_cast<uint16_t>(locate), bucket, 100000 + bucket + locate, 100);
+            }
+            elapsed += seconds([&] { calcAndOutputVWAP(bucket, symbol_table, merger); });
+        }
+        elapsed += seconds([&] { writer.close(); });
+        quiet.restore();
+        report("output", static_cast<size_t>(config.symbols) * minutes.perDay(), elapsed, "row");
+    }
+
+    // pipeline: reader thread and one processor, as ./ItchVwapProcessor runs by default
+    {
+        MemoryMappedFileReader reader(path.c_str());
+        AsyncVwapWriter writer(null_fd, options.buckets);
+        QuietStdout quiet;
+        double elapsed = seconds([&] { runPipeline(reader, options, writer, metrics); writer.close(); });
+        quiet.restore();
+        report("pipeline", frames, elapsed);
+    }
+
+    std::cout << "\n" << std::left << std::setw(22) << "--prefetch-batch" << std::right << std::setw(12) << "cycles/msg"
+        << std::setw(10) << "gain" << "\n";
+    for (const auto& [prefetch_batch, cycles] : prefetch_runs) {
+        std::cout << std::left << std::setw(22) << prefetch_batch << std::right
+            << std::setw(12) << std::setprecision(1) << static_cast<double>(cycles) / frames
+            << std::setw(9) << std::setprecision(1) << 100.0 * (1.0 - static_cast<double>(cycles) / prefetch_runs[0].second) << "%\n";
+    }
+
+    close(null_fd);
+    if (input.empty()) {
+        unlink(path.c_str());
+    }
+    return 0;
+}
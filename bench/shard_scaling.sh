@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+# Thread-count scaling of the sharded processor.
+# Usage: bench/shard_scaling.sh path/to/ItchVwapProcessor path/to/itchDatafile [thread counts...]
+# Runs each thread count in a scratch directory, reports wall time and checks that
+# output.csv is byte-identical to the single-threaded run.
+set -euo pipefail
+
+binary=$(realpath "$1")
+data=$(realpath "$2")
+shift 2
+threads=("$@")
+if [ ${#threads[@]} -eq 0 ]; then
+    threads=(1 2 4 8)
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+(cd "$work" && "$binary" --threads 1 "$data" > /dev/null && mv output.csv reference.csv)
+
+printf "%-8s %-10s %-10s %s\n" threads seconds speedup output
+base=""
+for t in "${threads[@]}"; do
+    start=$(date +%s.%N)
+    (cd "$work" && "$binary" --threads "$t" "$data" > /dev/null)
+    end=$(date +%s.%N)
+    secs=$(awk -v a="$start" -v b="$end" 'BEGIN { print b - a }')
+    if [ -z "$base" ]; then base=$secs; fi
+    if cmp -s "$work/output.csv" "$work/reference.csv"; then same=identical; else same=DIFFERENT; fi
+    printf "%-8s %-10.3f %-10.2f %s\n" "$t" "$secs" "$(awk -v a="$base" -v b="$secs" 'BEGIN { print a / b }')" "$same"
+done
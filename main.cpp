@@ -8,267 +8,293 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <fcntl.h>    // For open
+#include <unistd.h>   // For close, ftruncate
+#include <sys/stat.h> // For fstat
 
-#include <bit>
-#include <unordered_map>
-#include <map>
-#include <chrono>
-#include <thread>
-#include <array>
+#include <memory>
+#include <optional>
 
-#include "Message.h"
-#include "ThreadSafeQueue.h"
-#include "MemoryMappedFileReader.h"
+#include "Pipeline.h"
+#include "VwapStore.h"
+#include "FeedIndex.h"
+#include "Batch.h"
 
 using namespace GuG;
 
-void readDataIntoQueue(MemoryMappedFileReader& reader, ThreadSafeQueue<std::unique_ptr<ItchMessage>>& queue)
+int main(int argc, char* argv[])
 {
-
-    const std::byte* buffer = reinterpret_cast<std::byte*>(reader.data());
-    char msg_type;
-    size_t message_size = 0u;
-    size_t byte_read = 0u;
-    size_t byte_read_update = 0u;
-    const std::uint64_t MB = 1ULL << 20;             // 1 MB in bytes
-    const std::uint64_t update_threshold = 100 * MB; // 1 GB in bytes
-
-    while (byte_read < reader.size())
+    Options options;
+    try
     {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        std::cerr << e.what() << "\n";
+        printUsage(argv[0]);
+        return 1;
+    }
 
-        if (byte_read_update >= update_threshold)
+    if (!options.convert_path.empty())
+    {
+        try
         {
-            std::cout << byte_read / MB << " MB parsed\n";
-            byte_read_update = byte_read_update % update_threshold;
+            VwapStore store(options.convert_path.c_str());
+            writeVwapStoreCsv(store, STDOUT_FILENO);
         }
-
-        msg_type = read<char>(buffer);
-        message_size = MessageFactory::getMessageSize(msg_type);
-        if (message_size != 0)
+        catch (const std::runtime_error& e)
         {
-            auto message = MessageFactory::createMessage(msg_type, buffer);
-            if (message == nullptr)
-            {
-                skipByOffset(buffer, message_size);
-            }
-            else
-            {
-                queue.push(std::move(message));
-            }
+            std::cerr << options.convert_path << ": " << e.what() << std::endl;
+            return 1;
         }
-        byte_read += message_size + 1;
-        byte_read_update += message_size + 1;
+        return 0;
     }
-    queue.finish();
-    std::cout << "Finished Reading Data\n";
-}
 
-void calcAndOutputVWAP(uint8_t hour,
-    const std::map<uint16_t, std::string>& stock_map,
-    const std::unordered_map<uint16_t, std::array<uint64_t, 24>>& volume_map,
-    const std::unordered_map<uint16_t, std::array<uint64_t, 24>>& dollar_volume_map,
-    std::ostream& out = std::cout)
-{
-    for (const auto& [stock_id, stock_symbol] : stock_map)
+    if (!options.batch_dir.empty())
     {
-        uint64_t volume = volume_map.at(stock_id)[hour];
-        uint64_t dollar_volume = dollar_volume_map.at(stock_id)[hour];
-        if (volume == 0)
+        // every job runs this same binary
+        char program[4096];
+        ssize_t length = readlink("/proc/self/exe", program, sizeof(program) - 1);
+        if (length <= 0)
         {
-            continue;
+            std::cerr << "Failed to locate " << argv[0] << std::endl;
+            return 1;
         }
-        double vwap = dollar_volume / 10000.0 / volume;
-
-        out << std::left << stock_symbol << ","
-            << stock_id << ","
-            << static_cast<int>(hour) << ","
-            << std::fixed << std::setprecision(4) << vwap
-            << "\n";
+        program[length] = '\0';
+        return runBatch(options, program);
     }
-    std::cout << "Finished Processing Data of Hour: " << static_cast<unsigned int>(hour) << "\n";
-}
-
-void processMessage(ThreadSafeQueue<std::unique_ptr<ItchMessage>>& queue, std::ostream& out = std::cout)
-{
-    std::unique_ptr<ItchMessage> message;
-    std::map<uint16_t, std::string> stock_map;
-    std::unordered_map<uint64_t, uint32_t> order_price_map;
-    std::unordered_map<uint16_t, std::array<uint64_t, 24>> volume_map;
-    std::unordered_map<uint16_t, std::array<uint64_t, 24>> dollar_volume_map;
 
-    // match id : [stock_id, price, volume, time]
-    std::unordered_map<uint16_t, std::tuple<uint64_t, uint32_t, uint64_t, uint8_t>> matchID_trade_map;
-
-    uint8_t cur_hour = 0u;
-    uint8_t msg_hour = 0u;
-
-    while (true)
+    if (!options.build_index_path.empty() || !options.query_symbol.empty())
     {
-        if (!queue.pop(message))
+        if (isStreamInput(options) || isGzipInput(options))
+        {
+            std::cerr << "--build-index and --query need an uncompressed input file" << std::endl;
+            return 1;
+        }
+        try
         {
-            if (queue.isFinished())
+            MemoryMappedFileReader input(options.file_path);
+            if (!options.build_index_path.empty())
+            {
+                FeedIndexBuilder(input, options.index_interval).write(options.build_index_path);
+                return 0;
+            }
+            FeedIndex index(options.index_path.c_str(), input);
+            const FeedIndexSymbol* symbol = index.find(options.query_symbol);
+            if (symbol == nullptr)
             {
-                break;
+                std::cerr << options.query_symbol << " is not in the stock directory" << std::endl;
+                return 1;
             }
-            else
+            VwapQueryResult result = queryVwap(index, input, { symbol->stock_id, options.query_from, options.query_to });
+            char vwap[32] = {};
+            if (result.total.volume != 0)
             {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                continue;
+                *detail::appendPrice(vwap, result.total.notional, result.total.volume) = '\0';
             }
+            std::cout << "STOCK_SYMBOL,STOCK_ID,FROM,TO,VWAP,VOLUME,TRADES\n"
+                << symbol->symbol.view() << ',' << symbol->stock_id << ',' << formatClock(options.query_from) << ','
+                << formatClock(options.query_to) << ',' << vwap << ',' << result.total.volume << ',' << result.trades << std::endl;
         }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 
-        char message_type = message->message_type;
-        msg_hour = message->getMsgHour();
+    if (!options.metrics_path.empty() && !kMetricsEnabled)
+    {
+        std::cerr << "--metrics needs a build with -DGUG_WITH_METRICS" << std::endl;
+        return 1;
+    }
 
-        while (cur_hour < msg_hour)
-        { // leave time for fixing broken message
-            calcAndOutputVWAP(cur_hour, stock_map, volume_map, dollar_volume_map, out);
-            ++cur_hour;
-        }
-        switch (message_type)
+    std::unique_ptr<StreamReader> streamReader;
+    std::unique_ptr<MemoryMappedFileReader> fileReader;
+    std::unique_ptr<FileBlockReader> blockReader;
+#ifdef GUG_WITH_ZLIB
+    std::unique_ptr<GzipReader> gzipReader;
+#endif
+    try
+    {
+        if (isStreamInput(options))
         {
-        case 'R':
+            streamReader = std::make_unique<StreamReader>(options.file_path, options.follow);
+        }
+        else if (isGzipInput(options))
         {
-            auto casted_msg = static_cast<StockDirectoryMessage*>(message.get());
-            stock_map[casted_msg->stock_id] = casted_msg->stock_symbol;
-            volume_map[casted_msg->stock_id] = std::array<uint64_t, 24>{};
-            dollar_volume_map[casted_msg->stock_id] = std::array<uint64_t, 24>{};
-            break;
+#ifdef GUG_WITH_ZLIB
+            gzipReader = std::make_unique<GzipReader>(options.file_path, options.inflate_threads);
+#else
+            std::cerr << "Compressed input needs a build with -DGUG_WITH_ZLIB -lz" << std::endl;
+            return 1;
+#endif
         }
-        case 'A':
+        else if (options.input_backend == InputBackend::Mmap || options.input_backend == InputBackend::MmapWindow)
         {
-            auto casted_msg = static_cast<AddOrderMessage*>(message.get());
-            order_price_map[casted_msg->order_id] = casted_msg->price;
-            break;
+            fileReader = std::make_unique<MemoryMappedFileReader>(options.file_path);
         }
-        case 'F':
+        else
         {
-            auto casted_msg = static_cast<AddOrderMPIDAttributionMessage*>(message.get());
-            order_price_map[casted_msg->order_id] = casted_msg->price;
-            break;
+            ReadBackend backend = options.input_backend == InputBackend::Pread ? ReadBackend::Pread
+                : options.input_backend == InputBackend::Direct ? ReadBackend::Direct : ReadBackend::Uring;
+            blockReader = std::make_unique<FileBlockReader>(options.file_path, backend, options.read_block, options.read_ahead + 1);
         }
-        case 'E':
-        { // Actual Trade
-            auto casted_msg = static_cast<OrderExecutedMessage*>(message.get());
-            uint32_t cur_price = order_price_map[casted_msg->order_id];
-            uint32_t cur_volume = casted_msg->executed_shares;
+    }
+    catch (const std::runtime_error& e)
+    {
+        // every input fails the same way when it cannot be opened or mapped
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (blockReader && options.parse_threads > 1)
+    {
+        std::cerr << "--parse-threads needs --reader mmap or mmap-window" << std::endl;
+        return 1;
+    }
+    MessageFactory::useSimdLevel(options.decoder);
 
-            matchID_trade_map[casted_msg->match_number] = std::make_tuple(casted_msg->stock_id, cur_price, cur_volume, msg_hour);
-            dollar_volume_map[casted_msg->stock_id][msg_hour] += (static_cast<uint64_t>(cur_price) * cur_volume);
-            volume_map[casted_msg->stock_id][msg_hour] += static_cast<uint64_t>(cur_volume);
-            break;
+    bool checkpointing = !options.checkpoint_path.empty() || !options.resume_path.empty();
+    if (checkpointing && !fileReader)
+    {
+        std::cerr << "--checkpoint and --resume need an uncompressed input file read with --reader mmap or mmap-window" << std::endl;
+        return 1;
+    }
+    if (kBookEnabled && !options.order_tracking)
+    {
+        std::cerr << "The order book needs Delete and Cancel messages, --order-tracking off is not available" << std::endl;
+        return 1;
+    }
+    if ((kBarsEnabled || kBookEnabled) && !options.binary_output.empty())
+    {
+        std::cerr << "--binary-output stores the VWAP columns only, it is not available in a build with bar metrics or the order book" << std::endl;
+        return 1;
+    }
+    if (!options.resume_path.empty() && !options.binary_output.empty())
+    {
+        std::cerr << "--binary-output cannot be continued by --resume" << std::endl;
+        return 1;
+    }
+    std::optional<ResumePoint> resume;
+    if (!options.resume_path.empty())
+    {
+        try
+        {
+            resume = loadCheckpoint(options.resume_path, options, fileReader->size());
         }
-        case 'C':
+        catch (const std::runtime_error& e)
         {
-            auto casted_msg = static_cast<OrderExecutedWithPriceMessage*>(message.get());
-            if (casted_msg->printable == 'N')
-            {
-                // Only count Printable
-                continue;
-            }
-            uint32_t cur_price = casted_msg->execution_price;
-            uint32_t cur_volume = casted_msg->executed_shares;
+            std::cerr << options.resume_path << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
 
-            matchID_trade_map[casted_msg->match_number] = std::make_tuple(casted_msg->stock_id, cur_price, cur_volume, msg_hour);
-            dollar_volume_map[casted_msg->stock_id][msg_hour] += (static_cast<uint64_t>(cur_price) * cur_volume);
-            volume_map[casted_msg->stock_id][msg_hour] += static_cast<uint64_t>(cur_volume);
-            break;
+    int output_fd = open(options.output_path.c_str(), resume ? O_WRONLY : O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (output_fd == -1)
+    {
+        std::cerr << "Failed to open file" << std::endl;
+        return 1;
+    }
+    if (resume)
+    {
+        // drop the rows written after the checkpoint, they are produced again
+        struct stat sb;
+        off_t output_size = static_cast<off_t>(resume->header.output_size);
+        if (fstat(output_fd, &sb) == -1 || sb.st_size < output_size
+            || ftruncate(output_fd, output_size) == -1 || lseek(output_fd, output_size, SEEK_SET) == -1)
+        {
+            std::cerr << options.output_path << " does not hold the rows of the checkpoint" << std::endl;
+            return 1;
         }
-        case 'U':
+        std::cout << "Resuming at " << (resume->header.offset >> 20) << " MB\n";
+    }
+    std::unique_ptr<VwapStoreWriter> store;
+    AsyncVwapWriter::RowSink store_sink;
+    if (!options.binary_output.empty())
+    {
+        try
         {
-            auto casted_msg = static_cast<OrderReplaceMessage*>(message.get());
-            order_price_map.erase(casted_msg->original_order_id);
-            order_price_map[casted_msg->new_order_id] = casted_msg->price;
-            break;
+            store = std::make_unique<VwapStoreWriter>(options.binary_output, options.buckets);
         }
-        case 'P':
+        catch (const std::runtime_error& e)
         {
-            auto casted_msg = static_cast<NonCrossTradeMessage*>(message.get());
-            uint32_t cur_price = casted_msg->price;
-            uint32_t cur_volume = casted_msg->shares;
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        store_sink = [&store](const std::vector<VwapRow>& rows) { store->append(rows); };
+    }
+    AsyncVwapWriter writer(output_fd, options.buckets, std::move(store_sink), !resume);
+    std::unique_ptr<Checkpointer> checkpointer;
+    if (checkpointing)
+    {
+        checkpointer = std::make_unique<Checkpointer>(options, fileReader->size(), writer, std::move(resume));
+    }
+    PipelineMetrics metrics(options.threads,
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::nanoseconds(options.metrics_interval)));
 
-            matchID_trade_map[casted_msg->match_number] = std::make_tuple(casted_msg->stock_id, cur_price, cur_volume, msg_hour);
-            dollar_volume_map[casted_msg->stock_id][msg_hour] += (static_cast<uint64_t>(cur_price) * cur_volume);
-            volume_map[casted_msg->stock_id][msg_hour] += static_cast<uint64_t>(cur_volume);
-            break;
+    try
+    {
+        if (streamReader)
+        {
+            LivePublisher publisher(options.threads, options.buckets, options.live_output);
+            runPipeline(*streamReader, options, writer, metrics, &publisher);
         }
-        case 'Q':
+#ifdef GUG_WITH_ZLIB
+        else if (gzipReader)
         {
-            auto casted_msg = static_cast<CrossTradeMessage*>(message.get());
-            uint32_t cur_price = casted_msg->cross_price;
-            uint64_t cur_volume = casted_msg->shares;
-
-            matchID_trade_map[casted_msg->match_number] = std::make_tuple(casted_msg->stock_id, cur_price, cur_volume, msg_hour);
-            dollar_volume_map[casted_msg->stock_id][msg_hour] += (static_cast<uint64_t>(cur_price) * cur_volume);
-            volume_map[casted_msg->stock_id][msg_hour] += static_cast<uint64_t>(cur_volume);
-            break;
+            runPipeline(*gzipReader, options, writer, metrics);
         }
-        case 'B':
+#endif
+        else if (blockReader)
         {
-            auto casted_msg = static_cast<BrokenTradeMessage*>(message.get());
-            uint64_t match_number = casted_msg->match_number;
-
-            auto it = matchID_trade_map.find(casted_msg->match_number);
-            if (it == matchID_trade_map.end())
-            {
-                continue;
-            }
-            auto [stock_id, cur_price, cur_volume, trade_hour] = it->second;
-            dollar_volume_map[stock_id][trade_hour] -= (static_cast<uint64_t>(cur_price) * cur_volume);
-            volume_map[stock_id][trade_hour] -= static_cast<uint64_t>(cur_volume);
-            break;
+            runPipeline(*blockReader, options, writer, metrics);
         }
-        default:
-            continue;
+        else
+        {
+            runPipeline(*fileReader, options, writer, metrics, nullptr, checkpointer.get());
         }
     }
-    while (cur_hour < 24u)
+    catch (const std::exception& e)
     {
-        calcAndOutputVWAP(cur_hour, stock_map, volume_map, dollar_volume_map, out);
-        ++cur_hour;
+        // the rows of the input read before the error are written, then the run fails; this
+        // includes the failed allocation of the read blocks (std::bad_alloc)
+        writer.close();
+        if (checkpointer)
+        {
+            checkpointer->close();
+        }
+        close(output_fd);
+        std::cerr << options.file_path << ": " << e.what() << std::endl;
+        return 1;
     }
-}
 
-int main(int argc, char* argv[])
-{
-    const char* file_path;
-    if (argc < 2)
+    writer.close();
+    if (checkpointer)
     {
-        file_path = "01302019.NASDAQ_ITCH50";
+        checkpointer->close();
     }
-    else
+    if (!options.metrics_path.empty() && !metrics.writeJson(options.metrics_path))
     {
-        file_path = argv[1];
+        std::cerr << "Error writing " << options.metrics_path << std::endl;
     }
-
-    MemoryMappedFileReader fileReader(file_path);
-    ThreadSafeQueue<std::unique_ptr<ItchMessage>> queue;
-
-    registerMessageCreators();
-    MessageFactory::populateMessageSizeMap();
-
-    std::thread reader_thread(readDataIntoQueue, std::ref(fileReader), std::ref(queue));
-
-    std::ofstream file_stream("output.csv", std::ios::out | std::ios::trunc);
-    if (!file_stream.is_open())
+    if (close(output_fd) == -1)
     {
-        std::cerr << "Failed to open file" << std::endl;
-        return 1;
+        std::cerr << "Error closing output file" << std::endl;
+    }
+    if (store)
+    {
+        try
+        {
+            store->finish();
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
     }
-    file_stream << "STOCK_SYMBOL"
-        << ","
-        << "STOCK_ID"
-        << ","
-        << "HOUR_AFTER_MIDNIGHT"
-        << ","
-        << "VWAP" << std::endl;
-
-    std::thread process_thread(processMessage, std::ref(queue), std::ref(file_stream));
-    std::cout << "VWAP Job Finished \n";
-    // Join threads
-    reader_thread.join();
-    process_thread.join();
-
 
     return 0;
 }